@@ -2,13 +2,25 @@
 // Global knobs for transport, failure rates, run duration.
 #pragma once
 #include <chrono>
+#include "ibc/IBCChannel.h"
+#include "ibc/RelayerCoordinator.h"
 
 struct SimulationConfig
 {
     std::chrono::milliseconds defaultLinkLatency{50};
     double packetDropRate{0.01};
+    double linkBandwidthBytesPerSec{0.0}; // per-link cap, 0 = unlimited
+    size_t transportWorkers{4};           // delivery threads in Transport
     std::chrono::milliseconds runFor{std::chrono::minutes(2)};
     unsigned rngSeed{42};
+    ChannelOrdering channelOrdering{ChannelOrdering::Ordered}; // for channels opened via openIBC
+    std::chrono::milliseconds ibcPacketTimeout{std::chrono::seconds(30)}; // 0 = packets never expire
+    size_t ackBatchMaxPackets{1};         // >1 coalesces acks per channel into range acks
+    std::chrono::milliseconds ackBatchMaxDelay{20}; // flush deadline for a partial range ack
+    bool enableSendWindow{false};         // AIMD window of unacked packets per channel and destination
+    double sendWindowInitial{16};
+    double sendWindowMax{1024};
+    bool verifyPacketProofs{true};        // receivers check commitment proofs against their light clients
 
     // Traffic generation parameters
     std::chrono::milliseconds trafficGenInterval{100};  // Average time between transactions
@@ -23,6 +35,17 @@ struct SimulationConfig
     bool enableRelayerStateLogs{true};
 
     // Relayer configuration
-    size_t relayerCount{3};  // Number of concurrent relayers
-    bool enableRelayerCompetition{true};  // If false, use round-robin assignment
+    size_t relayerCount{3};  // Number of concurrent relayers (initial size when elastic)
+    bool enableElasticRelayers{false};    // grow/shrink the relayer set with load
+    size_t relayerMin{1};
+    size_t relayerMax{8};
+    std::chrono::milliseconds relayLatencySlo{50}; // elastic: target relayer queueing delay
+    bool enableRelayerCompetition{true};  // If false, use relayerAssignment
+    RelayerAssignment relayerAssignment{RelayerAssignment::RoundRobin};
+    std::chrono::milliseconds relayerLeaseTtl{500}; // Lease assignment only
+    size_t relayBatchMaxPackets{1};       // >1 batches packets per destination chain
+    std::chrono::milliseconds relayBatchMaxDelay{5}; // flush deadline for a partial batch
+    std::chrono::milliseconds relayAckTimeout{1000}; // resend data not acked by then
+    uint32_t relayRetryMaxAttempts{8};    // 0 disables relay retries
+    size_t relayMaxInFlight{4096};        // unacked packets tracked per relayer
 };
@@ -1,34 +1,95 @@
 // core/Blockchain.h
 // Represents one chain: ledger state, mempool, router, channels.
 #pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
 #include <memory>
+#include <optional>
+#include <shared_mutex>
 #include <vector>
 #include "Block.h"
 #include "Mempool.h"
 #include "EventBus.h"
 #include "ibc/IBCRouter.h"
 #include "ibc/IBCChannel.h"
+#include "ibc/ChannelTable.h"
+#include "ibc/CommitmentStore.h"
+#include "ibc/LightClient.h"
 #include "util/Logger.h"
+#include "util/Histogram.h"
 #include "util/Metrics.h"
+#include "util/TimerWheel.h"
 
 // Forward declaration
 class DetailedLogger;
 
+// End-to-end latencies of acknowledged packets, in ms
+struct IBCLatency
+{
+    Histogram sendToRecv; // only packets whose delivery event was seen
+    Histogram recvToAck;
+    Histogram sendToAck;
+};
+
+// AIMD congestion window for each channel and destination chain, counted in
+// unacknowledged packets that carry a timeout
+struct SendWindowParams
+{
+    bool enabled{false};
+    double initialWindow{16};
+    double minWindow{1};
+    double maxWindow{1024};
+    double decrease{0.5}; // factor applied on a timeout or drop
+};
+
 class Blockchain
 {
 public:
     explicit Blockchain(const std::string &chainId, EventBus &bus, Logger &log, MetricsSink &metrics, DetailedLogger* detailedLogger = nullptr);
+    ~Blockchain();
     const std::string &id() const;
 
-    // IBC primitives
-    Status openChannel(PortId port, ChannelId chan);
+    // IBC primitives; sendIBC fails with Backpressure while the send window is
+    // full, and with InvalidState if chan already sends to another counterparty
+    Status openChannel(PortId port, ChannelId chan, ChannelOrdering ordering = ChannelOrdering::Ordered);
     Status closeChannel(PortId port, ChannelId chan);
     Result<IBCPacket> sendIBC(PortId port, ChannelId chan,
                               const std::string &dstChain, PortId dstPort,
-                              ChannelId dstChan, const std::string &payload);
+                              ChannelId dstChan, const std::string &payload,
+                              IBCTimeout timeout = {});
     Status onIBCPacket(const IBCPacket &pkt);
     Status onIBCAck(const IBCPacket &ack);
 
+    // Acks are coalesced per channel into range acks of up to maxPackets
+    // sequences, sent once full, maxDelay old or at the next block; 1 sends
+    // one ack per packet
+    void setAckAggregation(size_t maxPackets, std::chrono::milliseconds maxDelay);
+
+    void setSendWindow(const SendWindowParams &params);
+    // Latencies of acked packets sent on port/chan to dstChain
+    IBCLatency ibcLatency(const PortId &port, const ChannelId &chan, const std::string &dstChain) const;
+    // Waits until sendIBC on port/chan to dstChain would fit in the window;
+    // false if it still would not after `timeout`
+    bool waitForSendWindow(const PortId &port, const ChannelId &chan, const std::string &dstChain,
+                           std::chrono::milliseconds timeout);
+
+    // Whether received packets must carry a proof of the source's commitment,
+    // checked against this chain's light client of the source (default on)
+    void setProofVerification(bool enabled);
+    // Replaces pkt's proof with one against our latest header; NotFound once
+    // the packet is acked or timed out
+    Status refreshProof(IBCPacket &pkt);
+
+    // Relative timeout for packets sent without one; zero means they never expire
+    void setDefaultPacketTimeout(std::chrono::milliseconds timeout);
+    // Runs for every sent packet that expires unacknowledged (e.g. to refund
+    // it), with its channel locked: it must not call into any Blockchain
+    void onPacketTimeout(std::function<void(const IBCPacket &)> handler);
+
     // Ledger state
     const Block &head() const;
     Status appendBlock(const Block &blk);
@@ -38,14 +99,105 @@ public:
 
     // Accessors
     Mempool &mempool();
+    // Applications attach to an open channel with router().setHandler(); the
+    // handler runs for each delivered packet with its channel locked
     IBCRouter &router();
 
 private:
     // Helper to generate channel map keys
     static std::string makeChannelKey(const PortId& port, const ChannelId& chan);
 
+    // A sent packet, kept until it is acked or expires
+    struct Outstanding
+    {
+        IBCPacket pkt;
+        std::chrono::steady_clock::time_point sentAt{};
+        std::optional<std::chrono::steady_clock::time_point> recvAt{}; // filled in by takeOutstanding
+        uint64_t timerId{0}; // 0: height timeout only, until the destination reaches it
+        bool timed{false};   // has a timeout and counts toward the send window
+    };
+
+    // Latencies of the acked packets of one channel and destination, in ms
+    struct ChannelLatency
+    {
+        IBCLatency hist;
+        uint64_t reported{0}; // sendToAck count at the last published percentiles
+    };
+
+    // Acks waiting to be sent together, for one channel pair
+    struct PendingAcks
+    {
+        IBCPacket ack; // routing fields
+        std::vector<uint64_t> sequences;
+        std::chrono::steady_clock::time_point since{};
+    };
+
+    struct SendWindow
+    {
+        double cwnd{0.0};
+        size_t inFlight{0};
+        uint64_t lastSent{0};
+        uint64_t recoverSeq{0}; // losses up to here belong to the last decrease
+    };
+
+    // IBC bookkeeping of the local channels that hash to one shard. Sends,
+    // receives and acks of a channel serialize on its book's lock, so
+    // channels in other books never wait for them.
+    struct ChannelBook
+    {
+        std::mutex mtx;
+        std::condition_variable windowCV;
+
+        // Send windows
+        SendWindowParams windowParams;
+        std::unordered_map<std::string, SendWindow> windows; // by port:channel>dstChain
+
+        // Sent packets and their timeouts
+        std::unordered_map<std::string, Outstanding> outstanding; // by port:channel#seq
+        std::unordered_map<uint64_t, std::string> timerKeys;      // timer id -> outstanding key
+        // Packets with a timeout height, by destination chain then height;
+        // entries of packets already gone are dropped once the height is reached
+        std::unordered_map<std::string, std::multimap<uint64_t, std::string>> heightTimeouts;
+        TimerWheel timeouts;
+        uint64_t nextTimerId{1};
+        std::unordered_map<std::string, ChannelLatency> latencies; // by port:channel>dstChain
+
+        // Acks waiting to go out for our receiving channels
+        std::unordered_map<std::string, PendingAcks> pendingAcks; // by sender channel -> our channel
+    };
+    static constexpr size_t kChannelBooks = 16;
+
+    // Book of a local channel; the helpers taking one need its lock held
+    ChannelBook &bookFor(const ChannelKey &key) { return books_[(key.hash >> 60) % kChannelBooks]; }
+
+    // Application handler, recv event and ack for an in-order packet
+    void deliverPacket(ChannelBook &book, const IBCPacket &pkt, const IBCPacketHandler &handler);
+    void deliverInOrder(ChannelBook &book, const std::vector<IBCPacket> &pkts, const IBCPacketHandler &handler);
+    void skipSourceTimeouts(); // sequences our senders gave up on
+    void sendAck(const IBCPacket &pkt, std::string payload);
+    void publishAck(const IBCPacket &ack);
+    void queueAck(ChannelBook &book, const IBCPacket &pkt);
+    void flushAcks(ChannelBook &book, bool all); // all, or only those older than the max delay
+    void flushAllAcks();
+    void requestResends(IBCChannel &channel); // for gaps open too long
+    bool isExpired(const IBCPacket &pkt) const; // as seen by this chain as destination
+    void trackOutstanding(ChannelBook &book, const IBCPacket &pkt);
+    bool takeOutstanding(ChannelBook &book, const std::string &key, Outstanding *out); // false if not tracked
+    void expireByHeight(ChannelBook &book); // starts the timers of packets whose destination reached their timeout height
+    void expireOutstanding(ChannelBook &book); // packets whose timer fired
+    double recordLatency(ChannelBook &book, const Outstanding &sent); // returns send->ack in ms
+    void publishLatencies(); // percentiles of channels with new samples
+    void timeOutPacket(ChannelBook &book, const IBCPacket &pkt); // cleanup and refund callbacks
+    uint64_t publishHeader(); // needs commitMtx_; returns the latest height
+    Status verifyPacketProof(const IBCPacket &pkt);
+    SendWindow &windowFor(ChannelBook &book, const PortId &port, const ChannelId &chan, const std::string &dstChain);
+    bool windowOpen(const SendWindow &w) const;
+    void onWindowAck(ChannelBook &book, const IBCPacket &sent);
+    void onWindowLoss(ChannelBook &book, const IBCPacket &pkt); // timeout or relay drop
+
     // Get or create channel (thread-safe)
-    IBCChannel* getOrCreateChannel(const PortId& port, const ChannelId& chan);
+    IBCChannel* getOrCreateChannel(const ChannelKey& key,
+                                   ChannelOrdering ordering = ChannelOrdering::Ordered);
 
     std::string chainId_;
     std::vector<Block> chain_;
@@ -57,7 +209,54 @@ private:
     DetailedLogger* detailedLogger_;
     std::vector<std::string> nodeIds_;
 
-    // Persistent IBC channels (key = port:channel)
-    std::unordered_map<std::string, std::unique_ptr<IBCChannel>> channels_;
-    mutable std::mutex channelsMtx_;
+    // Guards this chain's ledger (blocks and nodes) only; other chains have their own
+    mutable std::mutex chainMtx_;
+    std::atomic<uint64_t> height_{0}; // of the head block, readable without chainMtx_
+
+    // Persistent IBC channels, with their own shard locks
+    ChannelTable channels_;
+
+    // Per-channel IBC bookkeeping, sharded like the channel table
+    std::array<ChannelBook, kChannelBooks> books_;
+    std::atomic<size_t> outstandingCount_{0}; // across all books
+
+    // Ack aggregation
+    std::atomic<size_t> ackBatchMax_{1};
+    std::atomic<std::chrono::milliseconds> ackBatchDelay_{std::chrono::milliseconds(0)};
+
+    // Packet timeouts; handlers are read with their channel's book locked
+    std::atomic<std::chrono::milliseconds> defaultTimeout_{std::chrono::milliseconds(0)};
+    std::shared_mutex timeoutHandlersMtx_;
+    std::vector<std::function<void(const IBCPacket &)>> timeoutHandlers_;
+
+    // When the destination delivered our packets. Recorded from its
+    // IBCPacketRecv event, which is published with its channel locked, so
+    // this has its own lock.
+    std::mutex recvMtx_;
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> recvTimes_; // by port:channel#seq
+    int recvToken_{-1};
+
+    // Packets to us that their source timed out. Recorded from its
+    // IBCPacketTimeout event, published with its channel locked.
+    std::mutex sourceTimeoutsMtx_;
+    std::vector<IBCPacket> sourceTimeouts_;
+    int sourceTimeoutToken_{-1};
+
+    // Commitments to the packets we sent and have not seen end, and the
+    // headers announcing their root. Taken after a book's lock, so headers
+    // go out in root order.
+    std::mutex commitMtx_;
+    CommitmentStore commitments_;
+    bool commitmentsChanged_{false};
+    uint64_t headerHeight_{0};
+    uint64_t headerBlockHeight_{0}; // block height in the last header
+
+    // Our view of the other chains. Updated from their IBCClientUpdate
+    // events, published with their commitments locked, so this has its own lock.
+    std::atomic<bool> verifyProofs_{true};
+    std::mutex clientsMtx_;
+    std::unordered_map<std::string, LightClient> clients_;
+    int headerToken_{-1};
+
+    int dropToken_{-1}; // relay drops of our packets
 };
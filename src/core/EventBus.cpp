@@ -1,51 +1,486 @@
-
 #include "EventBus.h"
 #include <algorithm>
-#include <mutex>
+#include <condition_variable>
+#include <list>
+#include <string_view>
+#include <thread>
 
 namespace
 {
-    std::mutex &getBusMutex()
+    // Filter fields, as bits of an index mask
+    constexpr uint8_t kSrc = 1;
+    constexpr uint8_t kDst = 2;
+    constexpr uint8_t kChannel = 4;
+
+    // Fields an event is filtered on
+    struct Route
+    {
+        std::string_view src;
+        std::string_view dst;
+        std::string_view channel;
+    };
+
+    Route routeOf(const Event &e)
+    {
+        if (const IBCPacket *p = e.packet())
+            return {p->srcChain, p->dstChain, p->srcChannel.value};
+        return {e.chainId, {}, {}};
+    }
+
+    uint8_t maskOf(const EventFilter &f)
+    {
+        return (f.srcChain ? kSrc : 0) | (f.dstChain ? kDst : 0) | (f.channel ? kChannel : 0);
+    }
+
+    uint64_t routeHash(uint8_t mask, std::string_view src, std::string_view dst, std::string_view channel)
+    {
+        std::hash<std::string_view> h;
+        uint64_t x = mask;
+        if (mask & kSrc)
+            x = (x * 0x9E3779B97F4A7C15ULL) ^ h(src);
+        if (mask & kDst)
+            x = (x * 0x9E3779B97F4A7C15ULL) ^ h(dst);
+        if (mask & kChannel)
+            x = (x * 0x9E3779B97F4A7C15ULL) ^ h(channel);
+        return x;
+    }
+
+    uint64_t filterHash(const EventFilter &f)
+    {
+        return routeHash(maskOf(f), f.srcChain ? *f.srcChain : "", f.dstChain ? *f.dstChain : "",
+                         f.channel ? *f.channel : "");
+    }
+
+    bool matches(const EventFilter &f, const Route &r)
+    {
+        return (!f.srcChain || *f.srcChain == r.src) &&
+               (!f.dstChain || *f.dstChain == r.dst) &&
+               (!f.channel || *f.channel == r.channel);
+    }
+}
+
+// Packet events only merge with copies of the same packet; merging two
+// packets would lose one. Others keep the latest per kind and chain.
+std::string defaultCoalesceKey(const Event &e)
+{
+    std::string key = std::to_string(static_cast<int>(e.kind)) + "/" + e.chainId;
+    if (const IBCPacket *pkt = e.packet())
+    {
+        key += "/" + pkt->srcChain + "/" + pkt->srcPort.value + "/" + pkt->srcChannel.value + "/" +
+               std::to_string(static_cast<int>(pkt->type)) + "/" + std::to_string(pkt->sequence);
+    }
+    return key;
+}
+
+// Bounded queue plus the thread that drains it into one handler. Publishers
+// only touch the queue; the handler never runs on a publisher's thread.
+class EventBus::AsyncSubscriber
+{
+public:
+    AsyncSubscriber(Handler handler, AsyncOptions opts)
+        : handler_(std::move(handler)), opts_(std::move(opts))
+    {
+        opts_.capacity = std::max<size_t>(1, opts_.capacity);
+        if (opts_.overflow == OverflowPolicy::Coalesce && !opts_.coalesceKey)
+        {
+            opts_.coalesceKey = defaultCoalesceKey;
+        }
+        worker_ = std::thread([this]() { run(); });
+    }
+
+    ~AsyncSubscriber()
+    {
+        close();
+        join();
+    }
+
+    void enqueue(const Event &e)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (closed_)
+            return;
+
+        std::string key;
+        if (opts_.overflow == OverflowPolicy::Coalesce)
+        {
+            key = opts_.coalesceKey(e);
+            auto it = byKey_.find(key);
+            if (it != byKey_.end())
+            {
+                // Keep the queue position, take the newer content
+                it->second->event = e;
+                ++stats_.coalesced;
+                return;
+            }
+        }
+
+        if (queue_.size() >= opts_.capacity)
+        {
+            if (opts_.overflow == OverflowPolicy::Block)
+            {
+                notFull_.wait(lock, [this]
+                              { return closed_ || queue_.size() < opts_.capacity; });
+                if (closed_)
+                    return;
+            }
+            else
+            {
+                popFrontLocked();
+                ++stats_.dropped;
+            }
+        }
+
+        queue_.push_back(Item{e, std::move(key), std::chrono::steady_clock::now()});
+        if (opts_.overflow == OverflowPolicy::Coalesce)
+        {
+            byKey_.emplace(queue_.back().key, std::prev(queue_.end()));
+        }
+        ++stats_.enqueued;
+        stats_.highWater = std::max(stats_.highWater, queue_.size());
+        notEmpty_.notify_one();
+    }
+
+    // Stops accepting events and wakes blocked publishers and the worker
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+    void join()
+    {
+        if (worker_.joinable() && worker_.get_id() != std::this_thread::get_id())
+        {
+            worker_.join();
+        }
+    }
+
+    SubscriberStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        SubscriberStats s = stats_;
+        s.depth = queue_.size();
+        return s;
+    }
+
+private:
+    struct Item
+    {
+        Event event;
+        std::string key; // Coalesce policy only
+        std::chrono::steady_clock::time_point enqueuedAt;
+    };
+
+    Item popFrontLocked()
+    {
+        Item item = std::move(queue_.front());
+        queue_.pop_front();
+        if (opts_.overflow == OverflowPolicy::Coalesce)
+        {
+            byKey_.erase(item.key);
+        }
+        return item;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (true)
+        {
+            notEmpty_.wait(lock, [this]
+                           { return closed_ || !queue_.empty(); });
+            if (closed_)
+                return;
+
+            Item item = popFrontLocked();
+            notFull_.notify_one();
+
+            auto lag = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - item.enqueuedAt);
+            stats_.lastLag = lag;
+            stats_.maxLag = std::max(stats_.maxLag, lag);
+
+            lock.unlock();
+            bool failed = false;
+            try
+            {
+                handler_(item.event);
+            }
+            catch (...)
+            {
+                failed = true;
+            }
+            lock.lock();
+            ++stats_.delivered;
+            if (failed)
+                ++stats_.handlerErrors;
+        }
+    }
+
+    Handler handler_;
+    AsyncOptions opts_;
+    mutable std::mutex mtx_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::list<Item> queue_; // list, so coalesce lookups can hold iterators
+    std::unordered_map<std::string, std::list<Item>::iterator> byKey_;
+    SubscriberStats stats_;
+    bool closed_{false};
+    std::thread worker_;
+};
+
+EventBus::~EventBus()
+{
+    for (auto &[token, sub] : async_)
+    {
+        sub->close();
+        sub->join();
+    }
+    for (auto &slot : subs_)
     {
-        static std::mutex mtx;
-        return mtx;
+        delete slot.load(std::memory_order_relaxed);
     }
 }
 
 int EventBus::subscribe(EventKind kind, Handler h)
 {
-    std::lock_guard<std::mutex> lock(getBusMutex());
-    int token = nextToken_++;
-    subs_[kind].emplace_back(token, std::move(h));
+    return subscribe(kind, {}, std::move(h));
+}
+
+int EventBus::subscribe(EventKind kind, std::vector<EventFilter> filters, Handler h)
+{
+    std::lock_guard<std::mutex> lock(writeMtx_);
+    return addHandlerLocked(kind, std::move(filters), std::move(h));
+}
+
+int EventBus::subscribeAsync(EventKind kind, Handler h, AsyncOptions opts)
+{
+    return subscribeAsync(kind, {}, std::move(h), std::move(opts));
+}
+
+int EventBus::subscribeAsync(EventKind kind, std::vector<EventFilter> filters, Handler h, AsyncOptions opts)
+{
+    auto sub = std::make_shared<AsyncSubscriber>(std::move(h), std::move(opts));
+    std::lock_guard<std::mutex> lock(writeMtx_);
+    int token = addHandlerLocked(kind, std::move(filters), [sub](const Event &e)
+                                 { sub->enqueue(e); });
+    async_.emplace(token, std::move(sub));
     return token;
 }
 
+std::optional<SubscriberStats> EventBus::stats(int token) const
+{
+    std::lock_guard<std::mutex> lock(writeMtx_);
+    auto it = async_.find(token);
+    if (it == async_.end())
+        return std::nullopt;
+    return it->second->stats();
+}
+
 void EventBus::unsubscribe(int token)
 {
-    std::lock_guard<std::mutex> lock(getBusMutex());
-    for (auto &[kind, vec] : subs_)
+    std::shared_ptr<const HandlerList> old; // kept alive while we wait on it
+    std::shared_ptr<AsyncSubscriber> sub;
     {
-        auto it = std::remove_if(vec.begin(), vec.end(),
-                                 [token](const std::pair<int, Handler> &p)
-                                 { return p.first == token; });
-        if (it != vec.end())
+        std::lock_guard<std::mutex> lock(writeMtx_);
+        old = removeHandlerLocked(token);
+        auto it = async_.find(token);
+        if (it != async_.end())
         {
-            vec.erase(it, vec.end());
-            break;
+            sub = std::move(it->second);
+            async_.erase(it);
+        }
+    }
+
+    // Closing first releases publishers blocked on a full queue
+    if (sub)
+    {
+        sub->close();
+    }
+
+    // Publishes that picked up the old snapshot may still be running the
+    // handler; wait them out so the caller can destroy what it captured.
+    if (old)
+    {
+        while (old->readers.load(std::memory_order_seq_cst) != 0)
+        {
+            std::this_thread::yield();
         }
     }
+
+    if (sub)
+    {
+        sub->join();
+    }
+}
+
+int EventBus::addHandlerLocked(EventKind kind, std::vector<EventFilter> filters, Handler h)
+{
+    int token = nextToken_++;
+    auto &slot = subs_[static_cast<size_t>(kind)];
+    const HandlerList *old = slot.load(std::memory_order_relaxed);
+
+    std::vector<std::shared_ptr<const Subscription>> subs;
+    if (old)
+    {
+        subs = old->subs;
+    }
+    subs.push_back(std::make_shared<const Subscription>(Subscription{token, std::move(h), std::move(filters)}));
+    swapLocked(slot, std::move(subs));
+    return token;
+}
+
+// Swaps in a snapshot without `token`; returns the replaced one, or nullptr
+std::shared_ptr<const EventBus::HandlerList> EventBus::removeHandlerLocked(int token)
+{
+    for (auto &slot : subs_)
+    {
+        const HandlerList *list = slot.load(std::memory_order_relaxed);
+        if (!list)
+            continue;
+        auto it = std::find_if(list->subs.begin(), list->subs.end(),
+                               [token](const std::shared_ptr<const Subscription> &s)
+                               { return s->token == token; });
+        if (it == list->subs.end())
+            continue;
+
+        std::vector<std::shared_ptr<const Subscription>> subs;
+        subs.reserve(list->subs.size() - 1);
+        for (const auto &s : list->subs)
+        {
+            if (s->token != token)
+                subs.push_back(s);
+        }
+        return swapLocked(slot, std::move(subs));
+    }
+    return nullptr;
+}
+
+// Builds and publishes the snapshot for `subs`, retiring the current one,
+// which it returns (nullptr if there was none)
+std::shared_ptr<const EventBus::HandlerList> EventBus::swapLocked(std::atomic<const HandlerList *> &slot,
+                                                                  std::vector<std::shared_ptr<const Subscription>> subs)
+{
+    auto *next = new HandlerList();
+    next->subs = std::move(subs);
+    for (const auto &s : next->subs)
+    {
+        bool catchAll = s->filters.empty() ||
+                        std::any_of(s->filters.begin(), s->filters.end(),
+                                    [](const EventFilter &f)
+                                    { return maskOf(f) == 0; });
+        if (catchAll)
+        {
+            next->unfiltered.push_back(s.get());
+            continue;
+        }
+        next->multiFilter = next->multiFilter || s->filters.size() > 1;
+        for (const EventFilter &f : s->filters)
+        {
+            next->index[filterHash(f)].push_back(IndexEntry{&f, s.get()});
+            next->masks |= static_cast<uint8_t>(1u << maskOf(f));
+        }
+    }
+
+    const HandlerList *prev = slot.load(std::memory_order_relaxed);
+    slot.store(next, std::memory_order_seq_cst);
+    std::shared_ptr<const HandlerList> old(prev);
+    if (old)
+    {
+        retired_.emplace_back(static_cast<size_t>(&slot - subs_.data()), old);
+    }
+
+    // A retired snapshot is unreachable once no publish is reading it and
+    // none is between loading its slot and pinning: any that loaded it did
+    // so before the swap above, so it is counted in one or the other
+    std::erase_if(retired_, [this](const auto &entry)
+                  { return acquiring_[entry.first].load(std::memory_order_seq_cst) == 0 &&
+                           entry.second->readers.load(std::memory_order_seq_cst) == 0; });
+    return old;
+}
+
+// Pins the current snapshot for `kind`. The reader count is raised before the
+// slot is re-checked, so an unsubscribe that swapped the slot either sees the
+// count or this publish sees the new snapshot.
+const EventBus::HandlerList *EventBus::acquire(EventKind kind) const
+{
+    const auto &slot = subs_[static_cast<size_t>(kind)];
+    auto &acquiring = acquiring_[static_cast<size_t>(kind)];
+    acquiring.fetch_add(1, std::memory_order_seq_cst);
+    const HandlerList *list = slot.load(std::memory_order_seq_cst);
+    while (list)
+    {
+        list->readers.fetch_add(1, std::memory_order_seq_cst);
+        const HandlerList *current = slot.load(std::memory_order_seq_cst);
+        if (current == list)
+            break;
+        list->readers.fetch_sub(1, std::memory_order_release);
+        list = current;
+    }
+    acquiring.fetch_sub(1, std::memory_order_seq_cst);
+    return list;
 }
 
 void EventBus::publish(const Event &e)
 {
-    std::lock_guard<std::mutex> lock(getBusMutex());
-    auto it = subs_.find(e.kind);
-    if (it != subs_.end())
+    const HandlerList *list = acquire(e.kind);
+    if (!list)
+        return;
+
+    struct Release
+    {
+        const HandlerList *list;
+        ~Release() { list->readers.fetch_sub(1, std::memory_order_release); }
+    } release{list};
+
+    for (const Subscription *s : list->unfiltered)
+    {
+        s->handler(e);
+    }
+    if (list->index.empty())
+        return;
+
+    // One hash probe per field combination in use
+    const Route r = routeOf(e);
+    std::vector<const Subscription *> hits;
+    for (uint8_t mask = 1; mask < 8; ++mask)
     {
-        auto handlers = it->second;
-        for (const auto &[token, handler] : handlers)
+        if (!(list->masks & (1u << mask)))
+            continue;
+        auto it = list->index.find(routeHash(mask, r.src, r.dst, r.channel));
+        if (it == list->index.end())
+            continue;
+        for (const IndexEntry &entry : it->second)
         {
-            handler(e);
+            if (!matches(*entry.filter, r))
+                continue;
+            if (list->multiFilter)
+                hits.push_back(entry.sub); // may match more than once; dedup below
+            else
+                entry.sub->handler(e);
         }
     }
-}
\ No newline at end of file
+
+    if (!hits.empty())
+    {
+        std::sort(hits.begin(), hits.end(), [](const Subscription *a, const Subscription *b)
+                  { return a->token < b->token; });
+        hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+        for (const Subscription *s : hits)
+        {
+            s->handler(e);
+        }
+    }
+}
+
+bool EventBus::hasSubscribers(EventKind kind) const
+{
+    const HandlerList *list = acquire(kind); // pinned: retired snapshots get freed
+    if (!list)
+        return false;
+    bool any = !list->subs.empty();
+    list->readers.fetch_sub(1, std::memory_order_release);
+    return any;
+}
@@ -1,8 +1,18 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <variant>
 #include <vector>
+#include "Block.h"
+#include "ibc/IBCTypes.h"
 
 enum class EventKind
 {
@@ -12,28 +22,158 @@ enum class EventKind
     IBCPacketRecv,
     IBCAckSend,
     IBCAckRecv,
+    IBCResendRequest, // payload names a packet the receiver is still missing
+    IBCPacketTimeout, // payload is a sent packet that expired unacknowledged
+    IBCClientUpdate,  // payload is the publishing chain's new IBCHeader
     ConsensusRound,
     NetworkDrop,
     Error
 };
 
+// Typed event data. Built once by the publisher and shared by every
+// subscriber, so nobody has to parse `detail`.
+using EventPayload = std::variant<std::monostate,
+                                  std::shared_ptr<const IBCPacket>,
+                                  std::shared_ptr<const Block>,
+                                  std::shared_ptr<const IBCHeader>>;
+
 struct Event
 {
     EventKind kind;
     std::string chainId;
     std::string nodeId;
-    std::string detail; // human-readable payload
+    std::string detail; // human-readable, for logging
+    EventPayload payload{};
+
+    // nullptr when the event carries no payload of that type
+    const IBCPacket *packet() const
+    {
+        auto p = std::get_if<std::shared_ptr<const IBCPacket>>(&payload);
+        return p ? p->get() : nullptr;
+    }
+    const Block *block() const
+    {
+        auto p = std::get_if<std::shared_ptr<const Block>>(&payload);
+        return p ? p->get() : nullptr;
+    }
+    const IBCHeader *header() const
+    {
+        auto p = std::get_if<std::shared_ptr<const IBCHeader>>(&payload);
+        return p ? p->get() : nullptr;
+    }
+};
+
+// Content filter for a subscription; every field that is set must match.
+// Packet events match on the packet's chains and source channel; other
+// events match srcChain against Event::chainId.
+struct EventFilter
+{
+    std::optional<std::string> srcChain;
+    std::optional<std::string> dstChain;
+    std::optional<std::string> channel;
+};
+
+// What an async subscription does when its queue is full
+enum class OverflowPolicy
+{
+    Block,      // publisher waits for room (backpressure)
+    DropOldest, // oldest queued event is discarded
+    Coalesce    // same-key events merge while queued; drops oldest when full
+};
+
+// kind + chainId, plus the packet's source channel, type and sequence for
+// packet events, so distinct packets never merge
+std::string defaultCoalesceKey(const Event &e);
+
+struct AsyncOptions
+{
+    size_t capacity{1024};
+    OverflowPolicy overflow{OverflowPolicy::Block};
+    // Coalesce key; unset means defaultCoalesceKey
+    std::function<std::string(const Event &)> coalesceKey{};
+};
+
+struct SubscriberStats
+{
+    size_t depth{0};     // events queued now
+    size_t highWater{0}; // deepest the queue has been
+    uint64_t enqueued{0};
+    uint64_t delivered{0};
+    uint64_t dropped{0};
+    uint64_t coalesced{0};
+    uint64_t handlerErrors{0};
+    std::chrono::microseconds lastLag{0}; // enqueue -> handler start
+    std::chrono::microseconds maxLag{0};
 };
 
 class EventBus
 {
 public:
     using Handler = std::function<void(const Event &)>;
+
+    EventBus() = default;
+    ~EventBus();
+    EventBus(const EventBus &) = delete;
+    EventBus &operator=(const EventBus &) = delete;
+
     int subscribe(EventKind kind, Handler h);
+    // Delivered only events matching any of `filters` (empty: all events)
+    int subscribe(EventKind kind, std::vector<EventFilter> filters, Handler h);
+    // Handler runs on the subscription's own thread, fed by a bounded queue.
+    // It must not publish into its own full Block-policy queue.
+    int subscribeAsync(EventKind kind, Handler h, AsyncOptions opts = {});
+    int subscribeAsync(EventKind kind, std::vector<EventFilter> filters, Handler h, AsyncOptions opts = {});
+    std::optional<SubscriberStats> stats(int token) const; // async tokens only
+    // Returns once no publish is still running the handler (for async ones,
+    // once the executor has stopped; queued events are discarded). Do not call
+    // it from inside a handler of the same subscription or kind.
     void unsubscribe(int token);
+    // Lock-free and O(matching subscribers); sync handlers run on the
+    // publisher's thread. Unfiltered handlers run first.
     void publish(const Event &e);
+    // Lets publishers skip building payloads nobody will read
+    bool hasSubscribers(EventKind kind) const;
 
 private:
+    struct Subscription
+    {
+        int token;
+        Handler handler;
+        std::vector<EventFilter> filters;
+    };
+    struct IndexEntry
+    {
+        const EventFilter *filter;
+        const Subscription *sub;
+    };
+
+    // Immutable snapshot of one kind's subscriptions, rebuilt on change.
+    // Filtered ones are indexed by the hash of the fields they set.
+    struct HandlerList
+    {
+        std::vector<std::shared_ptr<const Subscription>> subs; // owns, in token order
+        std::vector<const Subscription *> unfiltered;
+        std::unordered_map<uint64_t, std::vector<IndexEntry>> index;
+        uint8_t masks{0};             // which field combinations occur in index
+        bool multiFilter{false};      // some subscription has several filters
+        mutable std::atomic<int> readers{0}; // publishes iterating this snapshot
+    };
+    static constexpr size_t kKindCount = static_cast<size_t>(EventKind::Error) + 1;
+
+    class AsyncSubscriber;
+
+    const HandlerList *acquire(EventKind kind) const;
+    int addHandlerLocked(EventKind kind, std::vector<EventFilter> filters, Handler h);
+    std::shared_ptr<const HandlerList> removeHandlerLocked(int token);
+    std::shared_ptr<const HandlerList> swapLocked(std::atomic<const HandlerList *> &slot,
+                                                  std::vector<std::shared_ptr<const Subscription>> subs);
+
+    mutable std::mutex writeMtx_; // serializes subscribe/unsubscribe only
     int nextToken_{1};
-    std::unordered_map<EventKind, std::vector<std::pair<int, Handler>>> subs_;
+    std::array<std::atomic<const HandlerList *>, kKindCount> subs_{};
+    // Publishes between loading a kind's slot and pinning what they loaded
+    mutable std::array<std::atomic<int>, kKindCount> acquiring_{};
+    // Replaced snapshots, by kind, until no publish can still reach them
+    std::vector<std::pair<size_t, std::shared_ptr<const HandlerList>>> retired_;
+    std::unordered_map<int, std::shared_ptr<AsyncSubscriber>> async_;
 };
@@ -2,15 +2,20 @@
 #include "util/DetailedLogger.h"
 #include "ibc/IBCTypes.h"
 #include <stdexcept>
-#include <sstream>
 
 // Helper: serialize/deserialize NodeMessage (simple, not robust)
-static std::string serializeNodeMessage(const NodeMessage &msg)
+std::string serializeNodeMessage(const NodeMessage &msg)
 {
     // Format: fromAddress|kind|bytes
-    std::ostringstream oss;
-    oss << msg.fromAddress << "|" << static_cast<int>(msg.kind) << "|" << msg.bytes;
-    return oss.str();
+    std::string kind = std::to_string(static_cast<int>(msg.kind));
+    std::string out;
+    out.reserve(msg.fromAddress.size() + kind.size() + msg.bytes.size() + 2);
+    out += msg.fromAddress;
+    out += '|';
+    out += kind;
+    out += '|';
+    out += msg.bytes;
+    return out;
 }
 
 static NodeMessage deserializeNodeMessage(const std::string &s)
@@ -44,13 +49,14 @@ Node::Node(const std::string &nodeId,
       detailedLogger_(detailedLogger)
 {
     // Register endpoint for this node's address
-    auto status = transport_.registerEndpoint(address_, [this](const std::string &bytes)
-                                              { this->onBytes(bytes); });
-    if (!status.ok())
+    auto reg = transport_.registerEndpoint(address_, [this](const std::string &bytes)
+                                           { this->onBytes(bytes); });
+    if (!reg.status.ok())
     {
-        log_.error("Failed to register endpoint: " + status.message);
+        log_.error("Failed to register endpoint: " + reg.status.message);
         throw std::runtime_error("Transport endpoint registration failed");
     }
+    endpoint_ = reg.value.value();
     chain_.registerNodeId(nodeId_);
 }
 
@@ -116,7 +122,7 @@ void Node::submitTransaction(const Transaction &tx)
 
     // Broadcast to all peers (simulate: in real, would have peer list)
     // Here, just send to self for demo
-    transport_.send(address_, address_, serializeNodeMessage(msg));
+    transport_.send(endpoint_, endpoint_, serializeNodeMessage(msg));
     metrics_.incCounter("tx_submitted");
 }
 
@@ -203,46 +209,7 @@ void Node::runLoop()
             // Deserialize IBC packet and route to blockchain
             try
             {
-                IBCPacket pkt = deserializeIBCPacket(msg.bytes);
-
-                if (pkt.type == IBCPacketType::Data)
-                {
-                    log_.debug("Node " + nodeId_ + " received IBC data packet from " +
-                               pkt.srcChain + " to " + pkt.dstChain +
-                               " (seq=" + std::to_string(pkt.sequence) + ")");
-
-                    Status s = chain_.onIBCPacket(pkt);
-                    if (s.ok())
-                    {
-                        metrics_.incCounter("ibc_packets_processed");
-                        log_.info("Successfully processed IBC packet seq=" + std::to_string(pkt.sequence));
-                        // Note: Blockchain.onIBCPacket() already logs detailed IBC events
-                    }
-                    else
-                    {
-                        metrics_.incCounter("ibc_packets_failed");
-                        log_.warn("Failed to process IBC packet: " + s.message);
-                    }
-                }
-                else if (pkt.type == IBCPacketType::Ack)
-                {
-                    log_.debug("Node " + nodeId_ + " received IBC ack from " +
-                               pkt.srcChain + " to " + pkt.dstChain +
-                               " (seq=" + std::to_string(pkt.sequence) + ")");
-
-                    Status s = chain_.onIBCAck(pkt);
-                    if (s.ok())
-                    {
-                        metrics_.incCounter("ibc_acks_processed");
-                        log_.info("Successfully processed IBC ack seq=" + std::to_string(pkt.sequence));
-                        // Note: Blockchain.onIBCAck() already logs detailed IBC events
-                    }
-                    else
-                    {
-                        metrics_.incCounter("ibc_acks_failed");
-                        log_.warn("Failed to process IBC ack: " + s.message);
-                    }
-                }
+                handleIBCPacket(deserializeIBCPacket(msg.bytes));
 
                 // Snapshot state after processing IBC message
                 snapshotState();
@@ -254,6 +221,27 @@ void Node::runLoop()
             }
             break;
         }
+        case NodeMessageKind::IBCBatch:
+        {
+            // Relayer batch: apply every packet in the order it was batched
+            try
+            {
+                std::vector<IBCPacket> pkts = deserializeIBCBatch(msg.bytes);
+                for (const IBCPacket &pkt : pkts)
+                {
+                    handleIBCPacket(pkt);
+                }
+                metrics_.incCounter("ibc_batches_processed");
+                metrics_.observe("ibc_batch_size", static_cast<double>(pkts.size()));
+                snapshotState();
+            }
+            catch (const std::exception &e)
+            {
+                log_.error("Failed to deserialize IBC batch: " + std::string(e.what()));
+                metrics_.incCounter("ibc_deserialization_errors");
+            }
+            break;
+        }
         default:
             log_.warn("Node " + nodeId_ + " received unknown message kind");
             break;
@@ -269,6 +257,48 @@ void Node::runLoop()
     }
 }
 
+void Node::handleIBCPacket(const IBCPacket &pkt)
+{
+    if (pkt.type == IBCPacketType::Data)
+    {
+        log_.debug("Node " + nodeId_ + " received IBC data packet from " +
+                   pkt.srcChain + " to " + pkt.dstChain +
+                   " (seq=" + std::to_string(pkt.sequence) + ")");
+
+        Status s = chain_.onIBCPacket(pkt);
+        if (s.ok())
+        {
+            metrics_.incCounter("ibc_packets_processed");
+            log_.info("Successfully processed IBC packet seq=" + std::to_string(pkt.sequence));
+            // Note: Blockchain.onIBCPacket() already logs detailed IBC events
+        }
+        else
+        {
+            metrics_.incCounter("ibc_packets_failed");
+            log_.warn("Failed to process IBC packet: " + s.message);
+        }
+    }
+    else if (pkt.type == IBCPacketType::Ack)
+    {
+        log_.debug("Node " + nodeId_ + " received IBC ack from " +
+                   pkt.srcChain + " to " + pkt.dstChain +
+                   " (seq=" + std::to_string(pkt.sequence) + ")");
+
+        Status s = chain_.onIBCAck(pkt);
+        if (s.ok())
+        {
+            metrics_.incCounter("ibc_acks_processed");
+            log_.info("Successfully processed IBC ack seq=" + std::to_string(pkt.sequence));
+            // Note: Blockchain.onIBCAck() already logs detailed IBC events
+        }
+        else
+        {
+            metrics_.incCounter("ibc_acks_failed");
+            log_.warn("Failed to process IBC ack: " + s.message);
+        }
+    }
+}
+
 void Node::snapshotState()
 {
     if (!detailedLogger_)
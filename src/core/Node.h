@@ -21,6 +21,7 @@ enum class NodeMessageKind
     Block,
     Transaction,
     IBC,
+    IBCBatch, // several IBC packets/acks, processed in order
     Unknown
 };
 
@@ -34,6 +35,8 @@ inline std::string toString(NodeMessageKind kind)
         return "tx";
     case NodeMessageKind::IBC:
         return "ibc";
+    case NodeMessageKind::IBCBatch:
+        return "ibc_batch";
     default:
         return "unknown";
     }
@@ -46,6 +49,9 @@ struct NodeMessage
     std::string bytes;    // serialized payload
 };
 
+// On-wire form handed to Transport (fromAddress|kind|bytes)
+std::string serializeNodeMessage(const NodeMessage &msg);
+
 class Node
 {
 public:
@@ -72,12 +78,14 @@ public:
 private:
     void runLoop(); // thread main
     void snapshotState(); // captures current node state
+    void handleIBCPacket(const IBCPacket &pkt); // data or ack, routed to the chain
 
     std::string nodeId_;
     Blockchain &chain_;
     std::unique_ptr<Consensus> consensus_;
     Transport &transport_;
     std::string address_;
+    EndpointHandle endpoint_{0};
     Logger &log_;
     MetricsSink &metrics_;
     DetailedLogger* detailedLogger_;
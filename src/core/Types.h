@@ -10,3 +10,9 @@ struct PeerId
     std::string chainId;
     std::string nodeId;
 };
+
+// Transport mailbox address of a peer ("<chainId>:<nodeId>").
+inline std::string toAddress(const PeerId &p)
+{
+    return p.chainId + ":" + p.nodeId;
+}
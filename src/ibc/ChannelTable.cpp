@@ -0,0 +1,51 @@
+#include "ChannelTable.h"
+#include <mutex>
+#include "util/Rng.h"
+
+ChannelKey::ChannelKey(std::string_view p, std::string_view c)
+    : port(p), channel(c), hash(splitmix64(stableHash(p) ^ splitmix64(stableHash(c))))
+{
+}
+
+std::string ChannelKey::str() const
+{
+    std::string s;
+    s.reserve(port.size() + 1 + channel.size());
+    s.append(port).append(":").append(channel);
+    return s;
+}
+
+IBCChannel *ChannelTable::find(const ChannelKey &key) const
+{
+    Shard &shard = shardOf(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.channels.find(key);
+    return it != shard.channels.end() ? it->second.get() : nullptr;
+}
+
+std::pair<IBCChannel *, bool> ChannelTable::getOrCreate(const ChannelKey &key,
+                                                        const std::function<std::unique_ptr<IBCChannel>()> &make)
+{
+    if (IBCChannel *channel = find(key))
+        return {channel, false};
+
+    Shard &shard = shardOf(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.channels.find(key);
+    if (it != shard.channels.end())
+        return {it->second.get(), false}; // created while we waited
+    it = shard.channels.emplace(StoredChannelKey(key), make()).first;
+    return {it->second.get(), true};
+}
+
+std::vector<IBCChannel *> ChannelTable::all() const
+{
+    std::vector<IBCChannel *> out;
+    for (Shard &shard : shards_)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        for (const auto &[key, channel] : shard.channels)
+            out.push_back(channel.get());
+    }
+    return out;
+}
@@ -0,0 +1,85 @@
+// ibc/ChannelTable.h
+// A chain's channels in lock-sharded maps, looked up without building strings.
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "IBCChannel.h"
+
+// (port, channel) with its hash computed once. A view: building one
+// allocates nothing, and it is valid while the ids it points into are.
+struct ChannelKey
+{
+    ChannelKey(const PortId &port, const ChannelId &chan) : ChannelKey(port.value, chan.value) {}
+    ChannelKey(std::string_view port, std::string_view chan);
+
+    std::string str() const; // "port:channel"
+
+    std::string_view port;
+    std::string_view channel;
+    uint64_t hash;
+};
+
+// Owns the strings a ChannelKey views; maps keyed by it can be searched
+// with a ChannelKey through ChannelKeyHash and ChannelKeyEq
+struct StoredChannelKey
+{
+    explicit StoredChannelKey(const ChannelKey &key)
+        : port(key.port), channel(key.channel), hash(key.hash) {}
+
+    std::string port;
+    std::string channel;
+    uint64_t hash;
+};
+
+struct ChannelKeyHash
+{
+    using is_transparent = void;
+    size_t operator()(const StoredChannelKey &k) const { return static_cast<size_t>(k.hash); }
+    size_t operator()(const ChannelKey &k) const { return static_cast<size_t>(k.hash); }
+};
+
+struct ChannelKeyEq
+{
+    using is_transparent = void;
+    template <typename A, typename B>
+    bool operator()(const A &a, const B &b) const
+    {
+        return a.hash == b.hash && std::string_view(a.port) == std::string_view(b.port) &&
+               std::string_view(a.channel) == std::string_view(b.channel);
+    }
+};
+
+// Channels are never removed, so pointers handed out stay valid for the
+// table's lifetime. Lookups take one shard's lock shared; only creating a
+// channel takes it exclusively.
+class ChannelTable
+{
+public:
+    IBCChannel *find(const ChannelKey &key) const; // nullptr if missing
+    // The channel at key, built by `make` if missing; second is true if it was
+    std::pair<IBCChannel *, bool> getOrCreate(const ChannelKey &key,
+                                              const std::function<std::unique_ptr<IBCChannel>()> &make);
+    std::vector<IBCChannel *> all() const;
+
+private:
+    static constexpr size_t kShards = 16;
+
+    struct Shard
+    {
+        mutable std::shared_mutex mtx;
+        std::unordered_map<StoredChannelKey, std::unique_ptr<IBCChannel>, ChannelKeyHash, ChannelKeyEq> channels;
+    };
+
+    // Top bits pick the shard; the maps use the low ones for buckets
+    Shard &shardOf(const ChannelKey &key) const { return shards_[(key.hash >> 60) % kShards]; }
+
+    mutable std::array<Shard, kShards> shards_;
+};
@@ -0,0 +1,240 @@
+#include "CommitmentStore.h"
+#include <utility>
+#include "util/Sha256.h"
+
+namespace
+{
+    const Hash kEmpty(32, '\0');
+
+    bool bitAt(const std::string &key, size_t depth)
+    {
+        return (static_cast<unsigned char>(key[depth / 8]) >> (7 - depth % 8)) & 1;
+    }
+
+    // Prefixes keep leaves and inner nodes from being passed off as each other
+    Hash leafHash(const std::string &key, const Hash &value)
+    {
+        return sha256(std::string(1, '\x00') + key + value);
+    }
+
+    Hash innerHash(const Hash &left, const Hash &right)
+    {
+        if (left == kEmpty && right == kEmpty)
+            return kEmpty;
+        return sha256(std::string(1, '\x01') + left + right);
+    }
+}
+
+struct CommitmentStore::Node
+{
+    bool leaf{false};
+    std::string key; // leaves only
+    Hash value;      // leaves only
+    Hash hash;
+    std::unique_ptr<Node> child[2];
+
+    static std::unique_ptr<Node> makeLeaf(std::string key, Hash value)
+    {
+        auto n = std::make_unique<Node>();
+        n->leaf = true;
+        n->key = std::move(key);
+        n->value = std::move(value);
+        n->hash = leafHash(n->key, n->value);
+        return n;
+    }
+
+    void rehash()
+    {
+        hash = innerHash(child[0] ? child[0]->hash : kEmpty, child[1] ? child[1]->hash : kEmpty);
+    }
+};
+
+CommitmentStore::CommitmentStore() = default;
+CommitmentStore::~CommitmentStore() = default;
+
+void CommitmentStore::set(std::string_view path, const Hash &value)
+{
+    std::string key = sha256(path);
+    std::unique_ptr<Node> *slot = &root_;
+    std::vector<Node *> parents;
+    for (size_t depth = 0;; ++depth)
+    {
+        Node *n = slot->get();
+        if (!n)
+        {
+            *slot = Node::makeLeaf(std::move(key), value);
+            ++size_;
+            break;
+        }
+        if (n->leaf)
+        {
+            if (n->key == key)
+            {
+                n->value = value;
+                n->hash = leafHash(n->key, n->value);
+                break;
+            }
+            // Push the existing leaf down one level and keep going
+            auto inner = std::make_unique<Node>();
+            bool b = bitAt(n->key, depth);
+            inner->child[b] = std::move(*slot);
+            *slot = std::move(inner);
+            n = slot->get();
+        }
+        parents.push_back(n);
+        slot = &n->child[bitAt(key, depth)];
+    }
+    for (auto it = parents.rbegin(); it != parents.rend(); ++it)
+    {
+        (*it)->rehash();
+    }
+}
+
+bool CommitmentStore::remove(std::string_view path)
+{
+    std::string key = sha256(path);
+    std::vector<std::unique_ptr<Node> *> slots{&root_};
+    for (size_t depth = 0;; ++depth)
+    {
+        Node *n = slots.back()->get();
+        if (!n)
+            return false;
+        if (n->leaf)
+        {
+            if (n->key != key)
+                return false;
+            break;
+        }
+        slots.push_back(&n->child[bitAt(key, depth)]);
+    }
+    slots.back()->reset();
+    --size_;
+
+    // Inner nodes left above a single leaf collapse into it
+    slots.pop_back();
+    for (auto it = slots.rbegin(); it != slots.rend(); ++it)
+    {
+        std::unique_ptr<Node> &slot = **it;
+        Node *n = slot.get();
+        std::unique_ptr<Node> &a = n->child[0];
+        std::unique_ptr<Node> &b = n->child[1];
+        if (!a && !b)
+        {
+            slot.reset();
+        }
+        else if (!a != !b && (a ? a : b)->leaf)
+        {
+            std::unique_ptr<Node> only = std::move(a ? a : b);
+            slot = std::move(only);
+        }
+        else
+        {
+            n->rehash();
+        }
+    }
+    return true;
+}
+
+Hash CommitmentStore::root() const
+{
+    return root_ ? root_->hash : kEmpty;
+}
+
+std::optional<CommitmentProof> CommitmentStore::prove(std::string_view path) const
+{
+    std::string key = sha256(path);
+    CommitmentProof proof;
+    const Node *n = root_.get();
+    for (size_t depth = 0; n && !n->leaf; ++depth)
+    {
+        bool b = bitAt(key, depth);
+        const Node *sibling = n->child[!b].get();
+        proof.siblings.push_back(sibling ? sibling->hash : kEmpty);
+        n = n->child[b].get();
+    }
+    if (!n || n->key != key)
+        return std::nullopt;
+    return proof;
+}
+
+bool CommitmentStore::verify(const Hash &root, std::string_view path, const Hash &value,
+                             const CommitmentProof &proof)
+{
+    std::string key = sha256(path);
+    if (proof.siblings.size() > key.size() * 8)
+        return false;
+    Hash h = leafHash(key, value);
+    for (size_t depth = proof.siblings.size(); depth-- > 0;)
+    {
+        const Hash &sibling = proof.siblings[depth];
+        h = bitAt(key, depth) ? innerHash(sibling, h) : innerHash(h, sibling);
+    }
+    return h == root;
+}
+
+// Format: depth (2 bytes), bitmap of non-empty siblings, then those siblings
+std::string CommitmentProof::encode() const
+{
+    size_t depth = siblings.size();
+    std::string out;
+    out += static_cast<char>(depth >> 8);
+    out += static_cast<char>(depth & 0xff);
+    std::string bitmap((depth + 7) / 8, '\0');
+    std::string hashes;
+    for (size_t i = 0; i < depth; ++i)
+    {
+        if (siblings[i] != kEmpty)
+        {
+            bitmap[i / 8] = static_cast<char>(bitmap[i / 8] | (0x80 >> (i % 8)));
+            hashes += siblings[i];
+        }
+    }
+    return out + bitmap + hashes;
+}
+
+std::optional<CommitmentProof> CommitmentProof::decode(std::string_view bytes)
+{
+    if (bytes.size() < 2)
+        return std::nullopt;
+    size_t depth = static_cast<unsigned char>(bytes[0]) << 8 | static_cast<unsigned char>(bytes[1]);
+    if (depth > 256)
+        return std::nullopt;
+    size_t pos = 2;
+    std::string_view bitmap = bytes.substr(pos, (depth + 7) / 8);
+    if (bitmap.size() != (depth + 7) / 8)
+        return std::nullopt;
+    pos += bitmap.size();
+
+    CommitmentProof proof;
+    proof.siblings.reserve(depth);
+    for (size_t i = 0; i < depth; ++i)
+    {
+        if ((static_cast<unsigned char>(bitmap[i / 8]) >> (7 - i % 8)) & 1)
+        {
+            if (pos + 32 > bytes.size())
+                return std::nullopt;
+            proof.siblings.emplace_back(bytes.substr(pos, 32));
+            pos += 32;
+        }
+        else
+        {
+            proof.siblings.push_back(kEmpty);
+        }
+    }
+    if (pos != bytes.size())
+        return std::nullopt;
+    return proof;
+}
+
+std::string packetCommitmentPath(const IBCPacket &pkt)
+{
+    return "commitments/ports/" + pkt.srcPort.value + "/channels/" + pkt.srcChannel.value +
+           "/sequences/" + std::to_string(pkt.sequence);
+}
+
+Hash packetCommitment(const IBCPacket &pkt)
+{
+    return sha256(std::to_string(pkt.timeoutHeight) + "/" + std::to_string(pkt.timeoutTimestamp) + "/" +
+                  pkt.dstChain + "/" + pkt.dstPort.value + "/" + pkt.dstChannel.value + "/" +
+                  sha256(pkt.payload));
+}
@@ -0,0 +1,51 @@
+// ibc/CommitmentStore.h
+// Packet commitments in a sparse Merkle tree, with membership proofs.
+#pragma once
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "IBCTypes.h"
+#include "core/Types.h"
+
+// Siblings on the path from the root down to a leaf; all-zero ones (empty
+// subtrees) are left out of the encoding and marked in a bitmap
+struct CommitmentProof
+{
+    std::vector<Hash> siblings; // top-down
+
+    std::string encode() const;
+    static std::optional<CommitmentProof> decode(std::string_view bytes);
+};
+
+// Keys are sha256(path), so the tree is balanced whatever the paths. A
+// subtree holding one leaf is that leaf's hash, which keeps proofs about
+// log2(size) long instead of 256. Not thread-safe.
+class CommitmentStore
+{
+public:
+    CommitmentStore();
+    ~CommitmentStore();
+    CommitmentStore(const CommitmentStore &) = delete;
+    CommitmentStore &operator=(const CommitmentStore &) = delete;
+
+    void set(std::string_view path, const Hash &value);
+    bool remove(std::string_view path);
+    Hash root() const; // 32 zero bytes when empty
+    size_t size() const { return size_; }
+    std::optional<CommitmentProof> prove(std::string_view path) const; // nullopt if absent
+
+    static bool verify(const Hash &root, std::string_view path, const Hash &value,
+                       const CommitmentProof &proof);
+
+private:
+    struct Node;
+    std::unique_ptr<Node> root_;
+    size_t size_{0};
+};
+
+// Where a source chain commits to a packet, and what it commits to: the
+// payload, timeouts and destination, so a relayer can change none of them
+std::string packetCommitmentPath(const IBCPacket &pkt);
+Hash packetCommitment(const IBCPacket &pkt);
@@ -1,50 +1,146 @@
 // filepath: /home/niishaaant/work/blockchain-comm-sim/src/ibc/IBCChannel.cpp
 
 #include "IBCChannel.h"
+#include <atomic>
+#include <map>
+#include <set>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    // Receipts of one counterparty on an unordered channel. Everything below
+    // base_ has arrived; the next kWindowBits sequences are a ring of bits;
+    // anything further ahead goes to a sparse set, bounded by kMaxOverflow.
+    class ReceiptWindow
+    {
+    public:
+        static constexpr uint64_t kWindowBits = 1024;
+        static constexpr size_t kMaxOverflow = 1 << 16;
+
+        // Records seq; Ok if new, InvalidState if a duplicate or too far ahead
+        Status record(uint64_t seq)
+        {
+            if (seq < base_)
+                return {ErrorCode::InvalidState, "Packet already received"};
+
+            if (seq >= base_ + kWindowBits)
+            {
+                if (overflow_.size() >= kMaxOverflow)
+                    return {ErrorCode::InvalidState, "Receipt window overflow"};
+                if (!overflow_.insert(seq).second)
+                    return {ErrorCode::InvalidState, "Packet already received"};
+                return {ErrorCode::Ok, ""};
+            }
+
+            uint64_t &word = bits_[(seq % kWindowBits) / 64];
+            uint64_t mask = uint64_t{1} << (seq % 64);
+            if (word & mask)
+                return {ErrorCode::InvalidState, "Packet already received"};
+            word |= mask;
+            advance();
+            return {ErrorCode::Ok, ""};
+        }
+
+    private:
+        bool test(uint64_t seq) const
+        {
+            return bits_[(seq % kWindowBits) / 64] & (uint64_t{1} << (seq % 64));
+        }
+
+        // Slides past the received prefix, freeing its bits for the sequences
+        // that enter the window, which may already be waiting in overflow_
+        void advance()
+        {
+            while (true)
+            {
+                uint64_t oldEnd = base_ + kWindowBits;
+                while (test(base_))
+                {
+                    bits_[(base_ % kWindowBits) / 64] &= ~(uint64_t{1} << (base_ % 64));
+                    base_++;
+                }
+                if (overflow_.empty() || base_ + kWindowBits == oldEnd)
+                    return;
+                for (uint64_t seq = oldEnd; seq < base_ + kWindowBits && !overflow_.empty(); ++seq)
+                {
+                    if (overflow_.erase(seq))
+                        bits_[(seq % kWindowBits) / 64] |= uint64_t{1} << (seq % 64);
+                }
+            }
+        }
+
+        uint64_t base_{1}; // sequences start at 1
+        uint64_t bits_[kWindowBits / 64]{};
+        std::unordered_set<uint64_t> overflow_;
+    };
+
+    // Receive side of one sender on an ordered channel. Packets ahead of
+    // nextSeq wait in `early` (at most kMaxEarly) until the gap fills.
+    struct OrderedInbox
+    {
+        static constexpr size_t kMaxEarly = 1024;
+
+        uint64_t nextSeq{1};
+        std::map<uint64_t, IBCPacket> early;
+        std::set<uint64_t> skipped; // ahead of nextSeq, given up by the source
+        std::chrono::steady_clock::time_point gapSince{}; // while early is non-empty
+        std::chrono::steady_clock::time_point lastReported{};
+    };
+
+    std::string senderKey(const IBCPacket &pkt)
+    {
+        return pkt.srcChain + "/" + pkt.srcPort.value + "/" + pkt.srcChannel.value;
+    }
+}
 
 // For thread safety
 class IBCChannelImpl
 {
 public:
-    IBCChannelImpl(std::string chainId, PortId port, ChannelId chan)
-        : chainId_(std::move(chainId)), port_(std::move(port)), chan_(std::move(chan)), state_(ChannelState::Init), nextSeq_(1) {}
+    IBCChannelImpl(std::string chainId, PortId port, ChannelId chan, ChannelOrdering ordering)
+        : chainId_(std::move(chainId)), port_(std::move(port)), chan_(std::move(chan)), ordering_(ordering),
+          state_(ChannelState::Init), nextSendSeq_(1) {}
 
     Status open()
     {
-        std::lock_guard<std::mutex> lock(mtx_);
-        if (state_ == ChannelState::Closed)
+        ChannelState expected = ChannelState::Init;
+        if (state_.compare_exchange_strong(expected, ChannelState::Open))
         {
-            return {ErrorCode::ChannelClosed, "Channel is closed"};
+            return {ErrorCode::Ok, "Channel opened"};
         }
-        if (state_ == ChannelState::Open)
+        if (expected == ChannelState::Closed)
         {
-            return {ErrorCode::InvalidState, "Channel already open"};
+            return {ErrorCode::ChannelClosed, "Channel is closed"};
         }
-        state_ = ChannelState::Open;
-        return {ErrorCode::Ok, "Channel opened"};
+        return {ErrorCode::InvalidState, "Channel already open"};
     }
 
     Status close()
     {
-        std::lock_guard<std::mutex> lock(mtx_);
-        if (state_ == ChannelState::Closed)
+        if (state_.exchange(ChannelState::Closed) == ChannelState::Closed)
         {
             return {ErrorCode::ChannelClosed, "Channel already closed"};
         }
-        state_ = ChannelState::Closed;
         return {ErrorCode::Ok, "Channel closed"};
     }
 
+    // Lock-free once bound: senders on one channel only share the sequence counter
     Result<IBCPacket> makePacket(const std::string &dstChain,
                                  PortId dstPort, ChannelId dstChan,
                                  const std::string &payload)
     {
-        std::lock_guard<std::mutex> lock(mtx_);
-        if (state_ != ChannelState::Open)
+        if (state_.load() != ChannelState::Open)
         {
             return {{ErrorCode::InvalidState, "Channel not open"}, std::nullopt};
         }
+        Status bound = bindCounterparty(dstChain, dstPort, dstChan);
+        if (!bound.ok())
+        {
+            return {bound, std::nullopt};
+        }
         IBCPacket pkt;
         pkt.type = IBCPacketType::Data;
         pkt.srcChain = chainId_;
@@ -53,47 +149,187 @@ public:
         pkt.srcChannel = chan_;
         pkt.dstPort = dstPort;
         pkt.dstChannel = dstChan;
-        pkt.sequence = nextSeq_++;
+        pkt.sequence = nextSendSeq_.fetch_add(1, std::memory_order_relaxed);
         pkt.payload = payload;
         return {{ErrorCode::Ok, ""}, pkt};
     }
 
-    Status acceptPacket(const IBCPacket &pkt)
+    Result<IBCDelivery> acceptPacket(const IBCPacket &pkt)
     {
+        if (state_.load() != ChannelState::Open)
+        {
+            return {{ErrorCode::ChannelClosed, "Channel not open"}, std::nullopt};
+        }
         std::lock_guard<std::mutex> lock(mtx_);
-        if (state_ != ChannelState::Open)
+        // Sequences are per sending channel, so receive state is too
+        if (ordering_ == ChannelOrdering::Unordered)
+        {
+            Status s = receipts_[senderKey(pkt)].record(pkt.sequence);
+            if (!s.ok())
+                return {s, std::nullopt};
+            return {{ErrorCode::Ok, "Packet accepted"}, IBCDelivery{{pkt}, {}}};
+        }
+
+        OrderedInbox &in = inboxes_[senderKey(pkt)];
+        if (pkt.sequence < in.nextSeq || in.early.count(pkt.sequence))
         {
-            return {ErrorCode::ChannelClosed, "Channel not open"};
+            return {{ErrorCode::InvalidState, "Packet already received"}, std::nullopt};
         }
-        // Check for correct sequencing
-        if (pkt.sequence != nextSeq_)
+        if (in.skipped.count(pkt.sequence))
         {
-            return {ErrorCode::InvalidState, "Packet sequence mismatch"};
+            return {{ErrorCode::InvalidState, "Packet timed out at the source"}, std::nullopt};
         }
-        // Accept the packet and increment sequence
-        nextSeq_++;
-        return {ErrorCode::Ok, "Packet accepted"};
+        auto now = std::chrono::steady_clock::now();
+        if (pkt.sequence > in.nextSeq)
+        {
+            if (pkt.sequence - in.nextSeq > OrderedInbox::kMaxEarly || in.early.size() >= OrderedInbox::kMaxEarly)
+            {
+                return {{ErrorCode::InvalidState, "Reorder buffer full"}, std::nullopt};
+            }
+            if (in.early.empty())
+                in.gapSince = now;
+            in.early.emplace(pkt.sequence, pkt);
+            buffered_++;
+            return {{ErrorCode::Ok, "Packet buffered"}, IBCDelivery{}};
+        }
+
+        // In sequence: deliver it and whatever it unblocks
+        IBCDelivery out;
+        out.packets.push_back(pkt);
+        in.nextSeq++;
+        release(in, out, now);
+        return {{ErrorCode::Ok, "Packet accepted"}, std::move(out)};
+    }
+
+    // The source timed pkt out, so it will never be relayed: its sequence
+    // stops holding back later ones and is no longer reported as a gap
+    IBCDelivery skipPacket(const IBCPacket &pkt)
+    {
+        IBCDelivery out;
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (ordering_ == ChannelOrdering::Unordered)
+        {
+            receipts_[senderKey(pkt)].record(pkt.sequence); // a late copy is then a duplicate
+            return out;
+        }
+        OrderedInbox &in = inboxes_[senderKey(pkt)];
+        if (pkt.sequence < in.nextSeq || in.early.count(pkt.sequence) ||
+            pkt.sequence - in.nextSeq > OrderedInbox::kMaxEarly)
+            return out;
+        if (pkt.sequence > in.nextSeq)
+        {
+            in.skipped.insert(pkt.sequence);
+            return out;
+        }
+        in.nextSeq++;
+        release(in, out, std::chrono::steady_clock::now());
+        return out;
+    }
+
+    std::vector<IBCPacket> overdueGaps(std::chrono::steady_clock::duration timeout)
+    {
+        std::vector<IBCPacket> gaps;
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto &[key, in] : inboxes_)
+        {
+            if (in.early.empty() || now - in.gapSince < timeout || now - in.lastReported < timeout)
+                continue;
+            in.lastReported = now;
+            IBCPacket missing = in.early.begin()->second;
+            missing.sequence = in.nextSeq;
+            missing.payload.clear();
+            missing.proof.clear();
+            gaps.push_back(std::move(missing));
+        }
+        return gaps;
     }
 
-    ChannelState state() const
+    size_t bufferedPackets() const
     {
         std::lock_guard<std::mutex> lock(mtx_);
-        return state_;
+        return buffered_;
     }
 
+    ChannelState state() const { return state_.load(); }
+
+    ChannelOrdering ordering() const { return ordering_; }
+
 private:
+    // A channel end has one counterparty, bound by the first send: sequences
+    // are per channel, and each receiver expects them without gaps
+    Status bindCounterparty(const std::string &dstChain, const PortId &dstPort, const ChannelId &dstChan)
+    {
+        if (!bound_.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(bindMtx_);
+            if (!bound_.load(std::memory_order_relaxed))
+            {
+                cpChain_ = dstChain;
+                cpPort_ = dstPort;
+                cpChan_ = dstChan;
+                bound_.store(true, std::memory_order_release);
+            }
+        }
+        if (dstChain != cpChain_ || dstPort.value != cpPort_.value || dstChan.value != cpChan_.value)
+        {
+            return {ErrorCode::InvalidState, "Channel is bound to " + cpChain_ + "/" + cpPort_.value + "/" +
+                                                 cpChan_.value};
+        }
+        return {ErrorCode::Ok, ""};
+    }
+
+    // Moves the packets now in sequence from `early` into out, stepping over
+    // skipped sequences (caller holds mtx_)
+    void release(OrderedInbox &in, IBCDelivery &out, std::chrono::steady_clock::time_point now)
+    {
+        if (in.early.empty() && in.skipped.empty())
+            return;
+        if (!in.early.empty())
+            out.gapAge = now - in.gapSince;
+        while (true)
+        {
+            auto it = in.early.begin();
+            if (it != in.early.end() && it->first == in.nextSeq)
+            {
+                out.packets.push_back(std::move(it->second));
+                in.early.erase(it);
+                buffered_--;
+            }
+            else if (!in.skipped.empty() && *in.skipped.begin() == in.nextSeq)
+            {
+                in.skipped.erase(in.skipped.begin());
+            }
+            else
+            {
+                break;
+            }
+            in.nextSeq++;
+        }
+        in.gapSince = now; // the next gap, if any, starts now
+    }
+
     std::string chainId_;
     PortId port_;
     ChannelId chan_;
-    mutable std::mutex mtx_;
-    ChannelState state_;
-    uint64_t nextSeq_;
+    const ChannelOrdering ordering_;
+    std::atomic<ChannelState> state_;
+    std::atomic<uint64_t> nextSendSeq_;
+    std::atomic<bool> bound_{false};
+    std::mutex bindMtx_;  // first send only
+    std::string cpChain_; // counterparty, immutable once bound_
+    PortId cpPort_;
+    ChannelId cpChan_;
+    mutable std::mutex mtx_; // receive side only
+    std::unordered_map<std::string, ReceiptWindow> receipts_; // Unordered: by source chain/port/channel
+    std::unordered_map<std::string, OrderedInbox> inboxes_;   // Ordered: by source chain/port/channel
+    size_t buffered_{0};                                      // early packets across inboxes_
 };
 
 // Implementation delegation
-IBCChannel::IBCChannel(std::string chainId, PortId port, ChannelId chan)
+IBCChannel::IBCChannel(std::string chainId, PortId port, ChannelId chan, ChannelOrdering ordering)
     : chainId_(std::move(chainId)),
-      impl_(std::make_unique<IBCChannelImpl>(chainId_, port, chan)) {}
+      impl_(std::make_unique<IBCChannelImpl>(chainId_, port, chan, ordering)) {}
 
 IBCChannel::~IBCChannel() = default;
 
@@ -103,8 +339,15 @@ Result<IBCPacket> IBCChannel::makePacket(const std::string &dstChain, PortId dst
 {
     return impl_->makePacket(dstChain, dstPort, dstChan, payload);
 }
-Status IBCChannel::acceptPacket(const IBCPacket &pkt) { return impl_->acceptPacket(pkt); }
+Result<IBCDelivery> IBCChannel::acceptPacket(const IBCPacket &pkt) { return impl_->acceptPacket(pkt); }
+IBCDelivery IBCChannel::skipPacket(const IBCPacket &pkt) { return impl_->skipPacket(pkt); }
+std::vector<IBCPacket> IBCChannel::overdueGaps(std::chrono::steady_clock::duration timeout)
+{
+    return impl_->overdueGaps(timeout);
+}
+size_t IBCChannel::bufferedPackets() const { return impl_->bufferedPackets(); }
 ChannelState IBCChannel::state() const { return impl_->state(); }
+ChannelOrdering IBCChannel::ordering() const { return impl_->ordering(); }
 
 // Note: You need to add `#include <mutex>` to your imports for thread safety.
 // Also, add a unique_ptr to IBCChannelImpl in your IBCChannel class definition for this delegation pattern.
\ No newline at end of file
@@ -1,9 +1,11 @@
 // ibc/IBCChannel.h
 // Unidirectional logical channel with sequencing and state.
 #pragma once
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 #include "IBCTypes.h"
 #include "util/Error.h"
 
@@ -14,20 +16,45 @@ enum class ChannelState
     Closed
 };
 
+enum class ChannelOrdering
+{
+    Ordered,  // packets accepted strictly in sequence
+    Unordered // any order, each sequence once
+};
+
+// What one accepted packet makes deliverable: on an ordered channel an early
+// packet yields nothing, and the one that fills a gap also releases the
+// packets buffered behind it
+struct IBCDelivery
+{
+    std::vector<IBCPacket> packets;               // in sequence order
+    std::chrono::steady_clock::duration gapAge{}; // how long the gap it filled was open
+};
+
 class IBCChannelImpl; // Forward declaration
 
 class IBCChannel
 {
 public:
-    IBCChannel(std::string chainId, PortId port, ChannelId chan);
+    IBCChannel(std::string chainId, PortId port, ChannelId chan,
+               ChannelOrdering ordering = ChannelOrdering::Ordered);
     ~IBCChannel();
     Status open();
     Status close();
+    // The first packet binds the channel to its destination; InvalidState for any other
     Result<IBCPacket> makePacket(const std::string &dstChain,
                                  PortId dstPort, ChannelId dstChan,
                                  const std::string &payload);
-    Status acceptPacket(const IBCPacket &pkt); // ordering/dup checks
+    Result<IBCDelivery> acceptPacket(const IBCPacket &pkt); // ordering/dup checks
+    // The source timed pkt out: its sequence is passed over instead of awaited;
+    // returns the packets that were only waiting on it
+    IBCDelivery skipPacket(const IBCPacket &pkt);
+    // Ordered: one placeholder per sender whose head-of-line gap has been open
+    // longer than `timeout` (and not reported within it), naming the missing sequence
+    std::vector<IBCPacket> overdueGaps(std::chrono::steady_clock::duration timeout);
+    size_t bufferedPackets() const; // ordered: early packets held back
     ChannelState state() const;
+    ChannelOrdering ordering() const;
 
 private:
     std::string chainId_;  // Kept for logging/debugging
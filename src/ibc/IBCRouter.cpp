@@ -2,31 +2,25 @@
 
 #include "IBCRouter.h"
 #include <mutex>
-#include <algorithm>
 
 // Bind ports to channels
-Status IBCRouter::bind(PortId port, ChannelId chan)
+Status IBCRouter::bind(PortId port, ChannelId chan, IBCPacketHandler handler)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    Key key{port.value, chan.value};
-    auto it = std::find_if(bindings_.begin(), bindings_.end(),
-                           [&](const Key &k)
-                           { return k.p == key.p && k.c == key.c; });
-    if (it != bindings_.end())
+    ChannelKey key(port, chan);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (bindings_.find(key) != bindings_.end())
     {
         return Status{ErrorCode::InvalidState, "Binding already exists"};
     }
-    bindings_.push_back(key);
+    bindings_.emplace(StoredChannelKey(key), std::make_shared<const IBCPacketHandler>(std::move(handler)));
     return Status{ErrorCode::Ok, "Bound successfully"};
 }
 
 Status IBCRouter::unbind(PortId port, ChannelId chan)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    Key key{port.value, chan.value};
-    auto it = std::find_if(bindings_.begin(), bindings_.end(),
-                           [&](const Key &k)
-                           { return k.p == key.p && k.c == key.c; });
+    ChannelKey key(port, chan);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = bindings_.find(key);
     if (it == bindings_.end())
     {
         return Status{ErrorCode::NotFound, "Binding not found"};
@@ -35,12 +29,34 @@ Status IBCRouter::unbind(PortId port, ChannelId chan)
     return Status{ErrorCode::Ok, "Unbound successfully"};
 }
 
-bool IBCRouter::isBound(PortId port, ChannelId chan) const
+Status IBCRouter::setHandler(const PortId &port, const ChannelId &chan, IBCPacketHandler handler)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    Key key{port.value, chan.value};
-    auto it = std::find_if(bindings_.begin(), bindings_.end(),
-                           [&](const Key &k)
-                           { return k.p == key.p && k.c == key.c; });
-    return it != bindings_.end();
-}
\ No newline at end of file
+    ChannelKey key(port, chan);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = bindings_.find(key);
+    if (it == bindings_.end())
+    {
+        return Status{ErrorCode::NotFound, "Binding not found"};
+    }
+    // Routes already handed out keep the old handler
+    it->second = std::make_shared<const IBCPacketHandler>(std::move(handler));
+    return Status{ErrorCode::Ok, "Handler set"};
+}
+
+bool IBCRouter::isBound(const PortId &port, const ChannelId &chan) const
+{
+    return isBound(ChannelKey(port, chan));
+}
+
+bool IBCRouter::isBound(const ChannelKey &key) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return bindings_.find(key) != bindings_.end();
+}
+
+std::shared_ptr<const IBCPacketHandler> IBCRouter::route(const ChannelKey &key) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = bindings_.find(key);
+    return it != bindings_.end() ? it->second : nullptr;
+}
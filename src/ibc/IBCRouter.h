@@ -1,25 +1,34 @@
 // ibc/IBCRouter.h
 // Demultiplexes incoming IBC packets to bound channels/ports.
 #pragma once
+#include <functional>
+#include <memory>
+#include <shared_mutex>
 #include <unordered_map>
-#include <vector>
-#include <mutex>
 #include "IBCTypes.h"
+#include "ChannelTable.h"
 #include "util/Error.h"
 
+// The application module bound to a channel; sees each packet delivered on it
+using IBCPacketHandler = std::function<void(const IBCPacket &)>;
+
+// Hash index from (port, channel) to its binding. Lookups take a ChannelKey,
+// so routing a packet neither builds a string nor scans the bindings.
 class IBCRouter
 {
 public:
-    Status bind(PortId port, ChannelId chan);
+    Status bind(PortId port, ChannelId chan, IBCPacketHandler handler = {});
     Status unbind(PortId port, ChannelId chan);
-    bool isBound(PortId port, ChannelId chan) const;
+    // Replaces the handler of an existing binding
+    Status setHandler(const PortId &port, const ChannelId &chan, IBCPacketHandler handler);
+    bool isBound(const PortId &port, const ChannelId &chan) const;
+    bool isBound(const ChannelKey &key) const;
+
+    // Handler bound at key (possibly empty); nullptr if nothing is bound.
+    // Stays usable after the binding is replaced or removed.
+    std::shared_ptr<const IBCPacketHandler> route(const ChannelKey &key) const;
 
 private:
-    struct Key
-    {
-        std::string p;
-        std::string c;
-    };
-    std::vector<Key> bindings_;
-    mutable std::mutex mutex_;
+    std::unordered_map<StoredChannelKey, std::shared_ptr<const IBCPacketHandler>, ChannelKeyHash, ChannelKeyEq> bindings_;
+    mutable std::shared_mutex mutex_;
 };
@@ -1,9 +1,11 @@
 // ibc/IBCTypes.cpp
 // Serialization utilities for IBC packets
 #include "IBCTypes.h"
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
+#include "util/Sha256.h"
 
 namespace {
     // Helper to escape pipe characters in strings
@@ -38,6 +40,9 @@ namespace {
         return result;
     }
 
+    const std::string kAckBatchPrefix = "acks:";
+    constexpr uint64_t kMaxAckRange = 1 << 16; // longest range a batch ack may claim
+
     // Split string by delimiter (not escaped)
     std::vector<std::string> split(const std::string& str, char delimiter) {
         std::vector<std::string> result;
@@ -63,10 +68,61 @@ namespace {
     }
 }
 
+std::string encodeAckRanges(std::vector<uint64_t> sequences) {
+    std::sort(sequences.begin(), sequences.end());
+    sequences.erase(std::unique(sequences.begin(), sequences.end()), sequences.end());
+
+    std::string out = kAckBatchPrefix;
+    for (size_t i = 0; i < sequences.size();) {
+        size_t j = i;
+        while (j + 1 < sequences.size() && sequences[j + 1] == sequences[j] + 1) {
+            ++j;
+        }
+        if (i > 0) {
+            out += ',';
+        }
+        out += std::to_string(sequences[i]);
+        if (j > i) {
+            out += '-' + std::to_string(sequences[j]);
+        }
+        i = j + 1;
+    }
+    return out;
+}
+
+bool isAckBatch(const IBCPacket& ack) {
+    return ack.type == IBCPacketType::Ack &&
+           ack.payload.compare(0, kAckBatchPrefix.size(), kAckBatchPrefix) == 0;
+}
+
+std::vector<uint64_t> ackedSequences(const IBCPacket& ack) {
+    if (!isAckBatch(ack)) {
+        return {ack.sequence};
+    }
+
+    std::vector<uint64_t> sequences;
+    try {
+        for (const std::string& range : split(ack.payload.substr(kAckBatchPrefix.size()), ',')) {
+            size_t dash = range.find('-');
+            uint64_t first = std::stoull(range.substr(0, dash));
+            uint64_t last = dash == std::string::npos ? first : std::stoull(range.substr(dash + 1));
+            if (last < first || last - first >= kMaxAckRange) {
+                return {};
+            }
+            for (uint64_t n = 0; n <= last - first; ++n) {
+                sequences.push_back(first + n);
+            }
+        }
+    } catch (const std::exception&) {
+        return {}; // malformed
+    }
+    return sequences;
+}
+
 std::string serializeIBCPacket(const IBCPacket& pkt) {
     std::ostringstream oss;
 
-    // Format: type|srcChain|dstChain|srcPort|srcChan|dstPort|dstChan|seq|payload
+    // Format: type|srcChain|dstChain|srcPort|srcChan|dstPort|dstChan|seq|payload|timeoutHeight|timeoutTs|proofHex|proofHeight
     oss << static_cast<int>(pkt.type) << "|"
         << escape(pkt.srcChain) << "|"
         << escape(pkt.dstChain) << "|"
@@ -75,7 +131,11 @@ std::string serializeIBCPacket(const IBCPacket& pkt) {
         << escape(pkt.dstPort.value) << "|"
         << escape(pkt.dstChannel.value) << "|"
         << pkt.sequence << "|"
-        << escape(pkt.payload);
+        << escape(pkt.payload) << "|"
+        << pkt.timeoutHeight << "|"
+        << pkt.timeoutTimestamp << "|"
+        << toHex(pkt.proof) << "|"
+        << pkt.proofHeight;
 
     return oss.str();
 }
@@ -83,8 +143,9 @@ std::string serializeIBCPacket(const IBCPacket& pkt) {
 IBCPacket deserializeIBCPacket(const std::string& str) {
     std::vector<std::string> parts = split(str, '|');
 
-    if (parts.size() != 9) {
-        throw std::runtime_error("Invalid IBCPacket serialization format: expected 9 parts, got " +
+    // 9 parts: written before packets had timeouts; 11: before proofs
+    if (parts.size() != 13 && parts.size() != 11 && parts.size() != 9) {
+        throw std::runtime_error("Invalid IBCPacket serialization format: expected 13 parts, got " +
                                  std::to_string(parts.size()));
     }
 
@@ -109,9 +170,62 @@ IBCPacket deserializeIBCPacket(const std::string& str) {
         // Parse payload
         pkt.payload = unescape(parts[8]);
 
+        if (parts.size() >= 11) {
+            pkt.timeoutHeight = std::stoull(parts[9]);
+            pkt.timeoutTimestamp = std::stoull(parts[10]);
+        }
+        if (parts.size() == 13) {
+            if (!fromHex(parts[11], pkt.proof)) {
+                throw std::runtime_error("proof is not hex");
+            }
+            pkt.proofHeight = std::stoull(parts[12]);
+        }
+
     } catch (const std::exception& e) {
         throw std::runtime_error("Failed to parse IBCPacket: " + std::string(e.what()));
     }
 
     return pkt;
 }
+
+std::string serializeIBCBatch(const std::vector<IBCPacket>& pkts) {
+    // Format: count\n then per packet: length\n<serialized packet>
+    std::string out = std::to_string(pkts.size()) + "\n";
+    for (const auto& pkt : pkts) {
+        std::string one = serializeIBCPacket(pkt);
+        out += std::to_string(one.size());
+        out += '\n';
+        out += one;
+    }
+    return out;
+}
+
+std::vector<IBCPacket> deserializeIBCBatch(const std::string& str) {
+    auto readNumber = [&str](size_t& pos) {
+        size_t nl = str.find('\n', pos);
+        if (nl == std::string::npos) {
+            throw std::runtime_error("Invalid IBC batch: truncated header");
+        }
+        size_t value = std::stoull(str.substr(pos, nl - pos));
+        pos = nl + 1;
+        return value;
+    };
+
+    size_t pos = 0;
+    size_t count = readNumber(pos);
+    // Every entry needs at least its "<len>\n" line, so a larger count is bogus.
+    if (count > (str.size() - pos) / 2) {
+        throw std::runtime_error("Invalid IBC batch: count exceeds message");
+    }
+    std::vector<IBCPacket> pkts;
+    pkts.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t len = readNumber(pos);
+        if (len > str.size() - pos) {
+            throw std::runtime_error("Invalid IBC batch: packet overruns message");
+        }
+        pkts.push_back(deserializeIBCPacket(str.substr(pos, len)));
+        pos += len;
+    }
+    return pkts;
+}
@@ -3,6 +3,7 @@
 #pragma once
 #include <string>
 #include <cstdint>
+#include <vector>
 
 enum class IBCPacketType
 {
@@ -30,8 +31,40 @@ struct IBCPacket
     ChannelId dstChannel;
     uint64_t sequence{0};
     std::string payload; // opaque app bytes
+    uint64_t timeoutHeight{0};    // destination height at which it expires, 0 = never
+    uint64_t timeoutTimestamp{0}; // system clock ms since epoch at which it expires, 0 = never
+    std::string proof;            // encoded CommitmentProof of a data packet; empty = none
+    uint64_t proofHeight{0};      // source header the proof is against
 };
 
+// What a light client learns of a chain: its packet commitment root at one
+// height, and its block height at the time. Heights count header updates,
+// which happen on commitment changes and new blocks.
+struct IBCHeader
+{
+    std::string chainId;
+    uint64_t height{0};
+    std::string commitmentRoot;
+    uint64_t blockHeight{0};
+};
+
+// Timeout requested for a new packet; zero fields are unset
+struct IBCTimeout
+{
+    uint64_t height{0};
+    uint64_t timestampMs{0};
+};
+
+// One ack packet can cover several sequences of a channel: its payload is
+// "acks:" and a list of ranges such as "1-5,7", its sequence the lowest one
+std::string encodeAckRanges(std::vector<uint64_t> sequences);
+bool isAckBatch(const IBCPacket& ack);
+std::vector<uint64_t> ackedSequences(const IBCPacket& ack); // ascending; empty if malformed
+
 // Serialization utilities
 std::string serializeIBCPacket(const IBCPacket& pkt);
 IBCPacket deserializeIBCPacket(const std::string& str);
+
+// Several packets in one message; decoded in the order they were added
+std::string serializeIBCBatch(const std::vector<IBCPacket>& pkts);
+std::vector<IBCPacket> deserializeIBCBatch(const std::string& str);
@@ -0,0 +1,51 @@
+#include "LightClient.h"
+#include <algorithm>
+#include <utility>
+#include "CommitmentStore.h"
+
+LightClient::LightClient(std::string chainId) : chainId_(std::move(chainId))
+{
+}
+
+Status LightClient::update(const IBCHeader &header)
+{
+    if (header.chainId != chainId_)
+    {
+        return {ErrorCode::InvalidState, "Header of " + header.chainId + " given to client of " + chainId_};
+    }
+    if (!roots_.empty() && header.height <= roots_.rbegin()->first)
+    {
+        return {ErrorCode::InvalidState, "Stale header at height " + std::to_string(header.height)};
+    }
+    roots_.emplace_hint(roots_.end(), header.height, header.commitmentRoot);
+    blockHeight_ = std::max(blockHeight_, header.blockHeight);
+    if (roots_.size() > kMaxHeaders)
+    {
+        roots_.erase(roots_.begin());
+    }
+    return {ErrorCode::Ok, ""};
+}
+
+uint64_t LightClient::latestHeight() const
+{
+    return roots_.empty() ? 0 : roots_.rbegin()->first;
+}
+
+Status LightClient::verifyPacket(const IBCPacket &pkt) const
+{
+    auto it = roots_.find(pkt.proofHeight);
+    if (it == roots_.end())
+    {
+        return {ErrorCode::NotFound, "No header of " + chainId_ + " at height " + std::to_string(pkt.proofHeight)};
+    }
+    std::optional<CommitmentProof> proof = CommitmentProof::decode(pkt.proof);
+    if (!proof)
+    {
+        return {ErrorCode::Serialization, "Malformed commitment proof"};
+    }
+    if (!CommitmentStore::verify(it->second, packetCommitmentPath(pkt), packetCommitment(pkt), *proof))
+    {
+        return {ErrorCode::InvalidState, "Commitment proof does not match the header"};
+    }
+    return {ErrorCode::Ok, ""};
+}
@@ -0,0 +1,31 @@
+// ibc/LightClient.h
+// A chain's view of another chain's headers, to verify its packet proofs.
+#pragma once
+#include <cstddef>
+#include <map>
+#include <string>
+#include "IBCTypes.h"
+#include "util/Error.h"
+
+// Keeps the commitment roots of the last kMaxHeaders heights of one chain.
+// Headers are trusted as given: in the simulator they come straight from
+// the chain. Not thread-safe.
+class LightClient
+{
+public:
+    static constexpr size_t kMaxHeaders = 1 << 14;
+
+    explicit LightClient(std::string chainId);
+
+    Status update(const IBCHeader &header); // heights must increase
+    uint64_t latestHeight() const;
+    uint64_t latestBlockHeight() const { return blockHeight_; } // for height timeouts
+    // Checks the packet's proof of its commitment against the root at its
+    // proofHeight; NotFound if that header is unknown or already pruned
+    Status verifyPacket(const IBCPacket &pkt) const;
+
+private:
+    std::string chainId_;
+    std::map<uint64_t, std::string> roots_; // height -> commitment root
+    uint64_t blockHeight_{0};
+};
@@ -1,36 +1,48 @@
 // filepath: /home/niishaaant/work/blockchain-comm-sim/src/ibc/Relayer.cpp
 
 #include "Relayer.h"
+#include "RelayerCoordinator.h"
 #include "core/Node.h"
 #include "util/DetailedLogger.h"
-#include <random>
+#include <algorithm>
+#include <cmath>
 #include <mutex>
-#include <sstream>
 
 namespace
 {
-    // Helper for random drop
-    bool shouldDrop(std::mt19937 &rng, double dropRate)
+    // Route drop for one packet. The draw is keyed by the packet's identity,
+    // so the outcome does not depend on which thread relays it or when.
+    // Each resend of a packet gets a fresh draw.
+    bool shouldDrop(const RngStream &rng, const IBCPacket &pkt, uint32_t attempt, double dropRate)
     {
-        std::uniform_real_distribution<double> dist(0.0, 1.0);
-        return dist(rng) < dropRate;
+        if (dropRate <= 0.0)
+            return false;
+        uint64_t id = stableHash(pkt.srcChain + "/" + pkt.srcChannel.value);
+        uint64_t event = pkt.sequence * 2 + (pkt.type == IBCPacketType::Data ? 0 : 1);
+        return rng.uniformAt(id ^ splitmix64(event) ^ splitmix64(attempt)) < dropRate;
+    }
+
+    // In-flight table key: (chain, port, channel, sequence, kind) of the sender side
+    std::string inFlightKey(const std::string &chain, const std::string &port, const std::string &channel,
+                            uint64_t sequence, IBCPacketType type)
+    {
+        return chain + "/" + port + "/" + channel + "#" + std::to_string(sequence) +
+               (type == IBCPacketType::Data ? "d" : "a");
+    }
+
+    std::string inFlightKey(const IBCPacket &pkt)
+    {
+        return inFlightKey(pkt.srcChain, pkt.srcPort.value, pkt.srcChannel.value, pkt.sequence, pkt.type);
     }
 }
 
-Relayer::Relayer(Transport &transport, EventBus &bus, const std::string &name, Logger &log, MetricsSink &metrics, DetailedLogger* detailedLogger)
-    : transport_(transport), bus_(bus), name_(name), log_(log), metrics_(metrics), detailedLogger_(detailedLogger)
+Relayer::Relayer(Transport &transport, EventBus &bus, const std::string &name, Logger &log, MetricsSink &metrics, DetailedLogger* detailedLogger, RngStream rng)
+    : transport_(transport), bus_(bus), name_(name), log_(log), metrics_(metrics), detailedLogger_(detailedLogger), rng_(rng)
 {
-    // Seed RNG with hash of name for deterministic behavior per relayer
-    std::hash<std::string> hasher;
-    rng_ = std::mt19937(static_cast<unsigned>(hasher(name)));
-
-    // Subscribe to IBC events
-    packetSendToken_ = bus_.subscribe(EventKind::IBCPacketSend,
-        [this](const Event &e) { this->onIBCPacketSendEvent(e); });
-    ackSendToken_ = bus_.subscribe(EventKind::IBCAckSend,
-        [this](const Event &e) { this->onIBCAckSendEvent(e); });
+    // Resolve our sender address once; relays then send by handle
+    endpoint_ = transport_.resolve(name_).value.value_or(0);
 
-    log_.info("Relayer '" + name_ + "' initialized with event subscriptions");
+    log_.info("Relayer '" + name_ + "' initialized");
 }
 
 Relayer::~Relayer()
@@ -42,92 +54,361 @@ Relayer::~Relayer()
     if (ackSendToken_ != -1) {
         bus_.unsubscribe(ackSendToken_);
     }
+    if (resendToken_ != -1) {
+        bus_.unsubscribe(resendToken_);
+    }
+    if (timeoutToken_ != -1) {
+        bus_.unsubscribe(timeoutToken_);
+    }
 }
 
 Status Relayer::connectChainMailbox(const std::string &chainId, const std::string &address)
 {
+    // The bus subscriptions filter on the chains known at start()
+    if (packetSendToken_ != -1)
+    {
+        return {ErrorCode::InvalidState, "Chains must be connected before start()"};
+    }
+    auto h = transport_.resolve(address);
+    if (!h.status.ok())
+        return h.status;
     std::lock_guard<std::mutex> lock(mtx_);
-    chainAddr_[chainId] = address;
+    chainAddr_[chainId] = h.value.value();
     return {ErrorCode::Ok, ""};
 }
 
-Status Relayer::relayPacket(const IBCPacket &pkt)
+bool Relayer::enqueue(std::deque<Inbound> &queue, const IBCPacket &pkt)
 {
-    std::string dstChain = pkt.dstChain;
-    std::string srcChain = pkt.srcChain;
-    std::string payload = pkt.payload;
+    {
+        std::lock_guard<std::mutex> lock(inboxMtx_);
+        if (inboxClosed_)
+            return false;
+        queue.push_back(Inbound{pkt, std::chrono::steady_clock::now()});
+    }
+    inboxCV_.notify_one();
+    return true;
+}
 
-    std::string toAddr;
+size_t Relayer::getBacklog()
+{
+    std::lock_guard<std::mutex> lock(inboxMtx_);
+    return inboxPackets_.size() + inboxAcks_.size();
+}
+
+// Subscribes once to packets and acks headed for any connected chain, so the
+// bus never hands us traffic we could not deliver
+void Relayer::subscribeEvents()
+{
+    std::vector<EventFilter> filters;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (const auto &[chainId, addr] : chainAddr_)
+        {
+            EventFilter f;
+            f.dstChain = chainId;
+            filters.push_back(std::move(f));
+        }
+    }
+    // No filters would match every chain, none of which we could reach
+    if (filters.empty())
+        return;
+
+    // Async, so handlers never run on the publishing chain's thread; Block keeps every packet
+    AsyncOptions opts;
+    opts.overflow = OverflowPolicy::Block;
+    packetSendToken_ = bus_.subscribeAsync(EventKind::IBCPacketSend, filters,
+        [this](const Event &e) { this->onIBCPacketSendEvent(e); }, opts);
+    ackSendToken_ = bus_.subscribeAsync(EventKind::IBCAckSend, filters,
+        [this](const Event &e) { this->onIBCAckSendEvent(e); }, opts);
+    // These two are cheap and rare, so handled on the publishing thread
+    resendToken_ = bus_.subscribe(EventKind::IBCResendRequest, filters,
+        [this](const Event &e) { this->onResendRequestEvent(e); });
+    timeoutToken_ = bus_.subscribe(EventKind::IBCPacketTimeout, filters,
+        [this](const Event &e) { this->onPacketTimeoutEvent(e); });
+}
+
+// Destination mailbox for pkt, after the simulated route drop
+Status Relayer::routeFor(const IBCPacket &pkt, EndpointHandle &toAddr, uint32_t attempt)
+{
     {
         std::lock_guard<std::mutex> lock(mtx_);
-        auto it = chainAddr_.find(dstChain);
+        auto it = chainAddr_.find(pkt.dstChain);
         if (it == chainAddr_.end())
             return {ErrorCode::NotFound, "Destination chain not connected"};
         toAddr = it->second;
     }
 
     // Simulate route drop
-    if (shouldDrop(rng_, routeDrop_))
-        return {ErrorCode::NetworkDrop, "Packet dropped on relayer route"};
-
-    // // Serialize IBCPacket as bytes (simple string for now)
-    // Transport::Bytes bytes(payload.begin(), payload.end());
-
-    // // Send via transport
-    // return transport_.send(name_, toAddr, bytes);
+    if (shouldDrop(rng_, pkt, attempt, routeDrop_))
+    {
+        return {ErrorCode::NetworkDrop, pkt.type == IBCPacketType::Data ? "Packet dropped on relayer route"
+                                                                        : "Ack dropped on relayer route"};
+    }
+    return {ErrorCode::Ok, ""};
+}
 
+Status Relayer::sendToChain(EndpointHandle toAddr, NodeMessageKind kind, std::string bytes)
+{
     NodeMessage msg;
     msg.fromAddress = name_;
-    msg.kind = NodeMessageKind::IBC;
-    msg.bytes = serializeIBCPacket(pkt); // Send full serialized IBCPacket, not just payload
-                         // Use the same on-wire encoding as Node::serializeNodeMessage
-    auto serializeNodeMessage = [](const NodeMessage &m)
-    {
-        std::ostringstream oss;
-        oss << m.fromAddress << "|" << static_cast<int>(m.kind) << "|" << m.bytes;
-        return oss.str();
-    };
-    return transport_.send(name_, toAddr, serializeNodeMessage(msg));
+    msg.kind = kind;
+    msg.bytes = std::move(bytes);
+    return transport_.send(endpoint_, toAddr, serializeNodeMessage(msg));
+}
+
+Status Relayer::relayPacket(const IBCPacket &pkt)
+{
+    EndpointHandle toAddr;
+    Status s = routeFor(pkt, toAddr);
+    if (!s.ok())
+        return s;
+    // Send full serialized IBCPacket, not just payload
+    return sendToChain(toAddr, NodeMessageKind::IBC, serializeIBCPacket(pkt));
 }
 
 Status Relayer::relayAck(const IBCPacket &ackPacket)
 {
-    std::string dstChain = ackPacket.dstChain;
-    std::string srcChain = ackPacket.srcChain;
-    std::string payload = ackPacket.payload;
+    EndpointHandle toAddr;
+    Status s = routeFor(ackPacket, toAddr);
+    if (!s.ok())
+        return s;
+    return sendToChain(toAddr, NodeMessageKind::IBC, serializeIBCPacket(ackPacket));
+}
+
+void Relayer::setCoordinator(RelayerCoordinator *coordinator)
+{
+    coordinator_ = coordinator;
+}
+
+void Relayer::setRetry(const RelayRetryParams &params)
+{
+    retryParams_ = params;
+}
+
+void Relayer::setProofRefresher(ProofRefresher refresher)
+{
+    proofRefresher_ = std::move(refresher);
+}
+
+size_t Relayer::getInFlight() const
+{
+    std::lock_guard<std::mutex> lock(inFlightMtx_);
+    return inFlight_.size();
+}
 
-    std::string toAddr;
+// Arms the retry timer for pkt: after a successful send we wait at least
+// ackTimeout for the ack, after a failed one only the backoff
+void Relayer::trackInFlight(const IBCPacket &pkt, bool sent)
+{
+    std::string key = inFlightKey(pkt);
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(inFlightMtx_);
+    auto it = inFlight_.find(key);
+    if (it == inFlight_.end())
     {
-        std::lock_guard<std::mutex> lock(mtx_);
-        auto it = chainAddr_.find(dstChain);
-        if (it == chainAddr_.end())
-            return {ErrorCode::NotFound, "Destination chain not connected"};
-        toAddr = it->second;
+        if (inFlight_.size() >= retryParams_.maxInFlight)
+        {
+            metrics_.incCounter("relayer_inflight_overflow");
+            return;
+        }
+        it = inFlight_.emplace(key, InFlight{pkt, 0, now}).first;
     }
 
-    // // Simulate route drop
-    // if (shouldDrop(rng_, routeDrop_))
-    //     return {ErrorCode::NetworkDrop, "Ack dropped on relayer route"};
+    InFlight &entry = it->second;
+    std::chrono::steady_clock::duration wait = backoff(key, entry.attempts);
+    if (sent)
+    {
+        wait = std::max<std::chrono::steady_clock::duration>(wait, retryParams_.ackTimeout);
+    }
+    entry.due = now + wait;
+    entry.generation = nextGeneration_++;
+    retryHeap_.push(RetryTimer{entry.due, key, entry.generation});
 
-    // // Serialize IBCPacket as bytes (simple string for now)
-    // Transport::Bytes bytes(payload.begin(), payload.end());
+    // Timers of cleared entries are skipped lazily; rebuild before they pile up
+    if (retryHeap_.size() > 2 * inFlight_.size() + 64)
+    {
+        decltype(retryHeap_) live;
+        for (const auto &[k, e] : inFlight_)
+        {
+            if (e.generation != 0)
+                live.push(RetryTimer{e.due, k, e.generation});
+        }
+        retryHeap_.swap(live);
+    }
+}
 
-    // // Send via transport
-    // return transport_.send(name_, toAddr, bytes);
+void Relayer::clearInFlight(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(inFlightMtx_);
+    inFlight_.erase(key);
+}
 
-    if (shouldDrop(rng_, routeDrop_))
-        return {ErrorCode::NetworkDrop, "Ack dropped on relayer route"};
-    NodeMessage msg;
-    msg.fromAddress = name_;
-    msg.kind = NodeMessageKind::IBC;
-    msg.bytes = serializeIBCPacket(ackPacket); // Send full serialized IBCPacket (ack), not just payload
-    auto serializeNodeMessage = [](const NodeMessage &m)
+// The ack for a data packet we sent: its round trip, retries included, is
+// what the coordinator weighs us by
+void Relayer::onAcked(const std::string &key)
+{
+    std::chrono::steady_clock::time_point firstTried;
+    {
+        std::lock_guard<std::mutex> lock(inFlightMtx_);
+        auto it = inFlight_.find(key);
+        if (it == inFlight_.end())
+            return;
+        firstTried = it->second.firstTried;
+        inFlight_.erase(it);
+    }
+    auto rtt = std::chrono::steady_clock::now() - firstTried;
+    metrics_.observe("relayer_ack_rtt_ms", std::chrono::duration<double, std::milli>(rtt).count());
+    if (coordinator_)
+    {
+        coordinator_->reportRoundTrip(name_, rtt);
+    }
+}
+
+// min(maxBackoff, baseBackoff * 2^attempts), scaled by a jitter in [0.5, 1).
+// The jitter is keyed by packet and attempt, so reruns back off identically.
+std::chrono::steady_clock::duration Relayer::backoff(const std::string &key, uint32_t attempts)
+{
+    double capMs = std::min(static_cast<double>(retryParams_.maxBackoff.count()),
+                            static_cast<double>(retryParams_.baseBackoff.count()) *
+                                std::ldexp(1.0, static_cast<int>(std::min<uint32_t>(attempts, 30))));
+    double jitter = 0.5 + 0.5 * rng_.uniformAt(stableHash(key) ^ splitmix64(attempts + 1));
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(capMs * jitter));
+}
+
+// Resends every entry whose timer expired; returns the next timer, if any
+std::optional<std::chrono::steady_clock::time_point> Relayer::fireDueRetries()
+{
+    std::vector<std::pair<IBCPacket, uint32_t>> resend;
+    {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(inFlightMtx_);
+        while (!retryHeap_.empty())
+        {
+            const RetryTimer &top = retryHeap_.top();
+            auto it = inFlight_.find(top.key);
+            if (it == inFlight_.end() || it->second.generation != top.generation)
+            {
+                retryHeap_.pop(); // acked, cleared or re-armed since
+                continue;
+            }
+            if (top.due > now)
+                break;
+            retryHeap_.pop();
+
+            InFlight &entry = it->second;
+            if (entry.attempts >= retryParams_.maxAttempts)
+            {
+                if (retryParams_.maxAttempts > 0)
+                {
+                    metrics_.incCounter("relayer_retries_exhausted");
+                    log_.warn("Giving up on seq=" + std::to_string(entry.pkt.sequence) + " after " +
+                              std::to_string(entry.attempts) + " retries");
+                }
+                inFlight_.erase(it);
+                continue;
+            }
+            entry.attempts++;
+            entry.generation = 0; // re-armed once the resend completes
+            resend.emplace_back(entry.pkt, entry.attempts);
+        }
+    }
+
+    for (auto &[pkt, attempt] : resend)
+    {
+        if (pkt.type == IBCPacketType::Data && proofRefresher_ && !proofRefresher_(pkt))
+        {
+            metrics_.incCounter("relayer_retries_uncommitted");
+            clearInFlight(inFlightKey(pkt));
+            continue;
+        }
+        metrics_.incCounter("relayer_retries");
+        log_.debug("Retrying seq=" + std::to_string(pkt.sequence) + " (attempt " + std::to_string(attempt) + ")");
+        dispatch(pkt, attempt);
+    }
+
+    std::lock_guard<std::mutex> lock(inFlightMtx_);
+    while (!retryHeap_.empty())
+    {
+        const RetryTimer &top = retryHeap_.top();
+        auto it = inFlight_.find(top.key);
+        if (it != inFlight_.end() && it->second.generation == top.generation)
+            return top.due;
+        retryHeap_.pop();
+    }
+    return std::nullopt;
+}
+
+void Relayer::setBatching(const RelayBatchParams &params)
+{
+    batchParams_ = params;
+    batchParams_.maxPackets = std::max<size_t>(1, batchParams_.maxPackets);
+}
+
+// Queues pkt for its destination chain; a full batch goes out immediately
+void Relayer::addToBatch(const IBCPacket &pkt, uint32_t attempt)
+{
+    EndpointHandle toAddr;
+    Status s = routeFor(pkt, toAddr, attempt);
+    if (!s.ok())
+    {
+        onRelayFailed(pkt, s);
+        return;
+    }
+
+    auto [it, inserted] = batches_.try_emplace(pkt.dstChain);
+    PendingBatch &batch = it->second;
+    if (batch.items.empty())
+    {
+        batch.deadline = std::chrono::steady_clock::now() + batchParams_.maxDelay;
+    }
+    batch.to = toAddr;
+    batch.items.push_back(pkt);
+    if (batch.items.size() >= batchParams_.maxPackets)
+    {
+        flushBatch(batch);
+    }
+}
+
+void Relayer::flushBatch(PendingBatch &batch)
+{
+    if (batch.items.empty())
+        return;
+
+    Status s = batch.items.size() == 1
+                   ? sendToChain(batch.to, NodeMessageKind::IBC, serializeIBCPacket(batch.items.front()))
+                   : sendToChain(batch.to, NodeMessageKind::IBCBatch, serializeIBCBatch(batch.items));
+    metrics_.observe("relayer_batch_size", static_cast<double>(batch.items.size()));
+    for (const IBCPacket &pkt : batch.items)
     {
-        std::ostringstream oss;
-        oss << m.fromAddress << "|" << static_cast<int>(m.kind) << "|" << m.bytes;
-        return oss.str();
-    };
-    return transport_.send(name_, toAddr, serializeNodeMessage(msg));
+        if (s.ok())
+            onRelayed(pkt);
+        else
+            onRelayFailed(pkt, s);
+    }
+    batch.items.clear();
+}
+
+// Flushes batches past their deadline (all of them when `all`); returns the
+// earliest deadline still pending
+std::optional<std::chrono::steady_clock::time_point> Relayer::flushDueBatches(bool all)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::optional<std::chrono::steady_clock::time_point> next;
+    for (auto &[chainId, batch] : batches_)
+    {
+        if (batch.items.empty())
+            continue;
+        if (all || batch.deadline <= now)
+        {
+            flushBatch(batch);
+        }
+        else if (!next || batch.deadline < *next)
+        {
+            next = batch.deadline;
+        }
+    }
+    return next;
 }
 
 void Relayer::setDropOnRoute(double probability)
@@ -142,167 +423,387 @@ Status Relayer::start()
     {
         return {ErrorCode::InvalidState, "Relayer already running"};
     }
+    {
+        std::lock_guard<std::mutex> lock(inboxMtx_);
+        inboxClosed_ = false;
+    }
+    // Kept across stop() and restart
+    if (packetSendToken_ == -1)
+    {
+        subscribeEvents();
+    }
+    if (coordinator_)
+    {
+        coordinator_->join(name_);
+    }
     worker_ = std::thread([this]() { runLoop(); });
     log_.info("Relayer '" + name_ + "' started");
     return {ErrorCode::Ok, ""};
 }
 
 void Relayer::stop()
+{
+    shutdown(false);
+}
+
+void Relayer::retire()
+{
+    shutdown(true);
+}
+
+// With `drain`, packets already queued are still relayed before the worker
+// exits; otherwise they are dropped
+void Relayer::shutdown(bool drain)
 {
     if (!running_.exchange(false))
         return;
 
-    pendingPackets_.close();
-    pendingAcks_.close();
+    // Leave first so our channels fail over while we shut down
+    if (coordinator_)
+    {
+        coordinator_->leave(name_);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(inboxMtx_);
+        inboxClosed_ = true;
+        if (!drain)
+        {
+            inboxPackets_.clear();
+            inboxAcks_.clear();
+        }
+    }
+    inboxCV_.notify_all();
 
     if (worker_.joinable())
     {
         worker_.join();
     }
+    if (!drain)
+    {
+        // Anything still unacked is abandoned with us; a retiring relayer
+        // keeps it for takeUnacked()
+        std::lock_guard<std::mutex> lock(inFlightMtx_);
+        inFlight_.clear();
+        retryHeap_ = {};
+    }
+    recordEventQueueMetrics();
     log_.info("Relayer '" + name_ + "' stopped");
 }
 
-void Relayer::runLoop()
+std::vector<IBCPacket> Relayer::takeUnacked()
 {
-    log_.info("Relayer '" + name_ + "' run loop started");
+    std::vector<IBCPacket> unacked;
+    std::lock_guard<std::mutex> lock(inFlightMtx_);
+    unacked.reserve(inFlight_.size());
+    for (auto &[key, entry] : inFlight_)
+        unacked.push_back(std::move(entry.pkt));
+    inFlight_.clear();
+    retryHeap_ = {};
+    return unacked;
+}
 
-    while (running_)
+void Relayer::adoptUnacked(const std::vector<IBCPacket> &pkts)
+{
+    auto now = std::chrono::steady_clock::now();
+    size_t adopted = 0;
     {
-        // Process pending packets with a timeout approach
-        bool processed = false;
-
-        // Try to get a packet (non-blocking)
-        auto pktOpt = pendingPackets_.tryPop();
-        if (pktOpt.has_value())
+        std::lock_guard<std::mutex> lock(inFlightMtx_);
+        for (const IBCPacket &pkt : pkts)
         {
-            IBCPacket pkt = pktOpt.value();
-            log_.info("Relaying packet from " + pkt.srcChain + " to " + pkt.dstChain + " (seq=" + std::to_string(pkt.sequence) + ")");
-
-            Status s = relayPacket(pkt);
-            if (s.ok())
+            std::string key = inFlightKey(pkt);
+            if (inFlight_.count(key))
+                continue;
+            if (inFlight_.size() >= retryParams_.maxInFlight)
             {
-                packetsRelayed_++;
-                metrics_.incCounter("relayer_packets_relayed");
-                log_.debug("Successfully relayed packet seq=" + std::to_string(pkt.sequence));
-
-                // Detailed IBC event logging
-                if (detailedLogger_)
-                {
-                    detailedLogger_->logIBCEvent(
-                        IBCEventType::PacketRelayed,
-                        pkt.srcChain,
-                        pkt.dstChain,
-                        pkt.srcPort.value,
-                        pkt.srcChannel.value,
-                        pkt.dstPort.value,
-                        pkt.dstChannel.value,
-                        pkt.sequence,
-                        pkt.payload,
-                        name_
-                    );
-                }
-
-                logRelayerState("packet_relayed", "seq=" + std::to_string(pkt.sequence));
+                metrics_.incCounter("relayer_inflight_overflow");
+                continue;
             }
-            else
-            {
-                failures_++;
-                metrics_.incCounter("relayer_packets_failed");
-                log_.warn("Failed to relay packet: " + s.message);
-                logRelayerState("packet_failed", s.message);
-            }
-            processed = true;
+            InFlight entry{pkt, 0, now};
+            entry.due = now;
+            entry.generation = nextGeneration_++;
+            retryHeap_.push(RetryTimer{entry.due, key, entry.generation});
+            inFlight_.emplace(std::move(key), std::move(entry));
+            adopted++;
         }
+    }
+    metrics_.incCounter("relayer_inflight_adopted", static_cast<double>(adopted));
+    {
+        std::lock_guard<std::mutex> lock(inboxMtx_);
+        retryKick_ = true;
+    }
+    inboxCV_.notify_one();
+}
 
-        // Try to get an ack (non-blocking)
-        auto ackOpt = pendingAcks_.tryPop();
-        if (ackOpt.has_value())
-        {
-            IBCPacket ack = ackOpt.value();
-            log_.info("Relaying ack from " + ack.srcChain + " to " + ack.dstChain + " (seq=" + std::to_string(ack.sequence) + ")");
-
-            Status s = relayAck(ack);
-            if (s.ok())
-            {
-                acksRelayed_++;
-                metrics_.incCounter("relayer_acks_relayed");
-                log_.debug("Successfully relayed ack seq=" + std::to_string(ack.sequence));
-
-                // Detailed IBC event logging
-                if (detailedLogger_)
-                {
-                    detailedLogger_->logIBCEvent(
-                        IBCEventType::AckRelayed,
-                        ack.srcChain,
-                        ack.dstChain,
-                        ack.srcPort.value,
-                        ack.srcChannel.value,
-                        ack.dstPort.value,
-                        ack.dstChannel.value,
-                        ack.sequence,
-                        ack.payload,
-                        name_
-                    );
-                }
+void Relayer::runLoop()
+{
+    log_.info("Relayer '" + name_ + "' run loop started");
 
-                logRelayerState("ack_relayed", "seq=" + std::to_string(ack.sequence));
-            }
+    std::deque<Inbound> packets;
+    std::deque<Inbound> acks;
+    std::optional<std::chrono::steady_clock::time_point> nextFlush;
+    while (true)
+    {
+        {
+            // One wait covers both queues; wakes as soon as either gets work,
+            // or when the oldest partial batch or a retry is due
+            std::unique_lock<std::mutex> lock(inboxMtx_);
+            auto ready = [this]
+            { return inboxClosed_ || retryKick_ || !inboxPackets_.empty() || !inboxAcks_.empty(); };
+            if (nextFlush)
+                inboxCV_.wait_until(lock, *nextFlush, ready);
             else
-            {
-                failures_++;
-                metrics_.incCounter("relayer_acks_failed");
-                log_.warn("Failed to relay ack: " + s.message);
-                logRelayerState("ack_failed", s.message);
-            }
-            processed = true;
+                inboxCV_.wait(lock, ready);
+            retryKick_ = false;
+            if (inboxClosed_ && inboxPackets_.empty() && inboxAcks_.empty())
+                break;
+            packets.swap(inboxPackets_);
+            acks.swap(inboxAcks_);
+        }
+        if (coordinator_)
+        {
+            coordinator_->reportBacklog(name_, packets.size() + acks.size());
         }
 
-        // If nothing was processed, sleep briefly to avoid busy-waiting
-        if (!processed)
+        // Drain the whole batch without touching the lock again
+        for (const Inbound &in : packets)
+        {
+            observeQueueWait(in.queuedAt);
+            process(in.pkt);
+        }
+        for (const Inbound &in : acks)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            observeQueueWait(in.queuedAt);
+            process(in.pkt);
         }
+        packets.clear();
+        acks.clear();
+        nextFlush = flushDueBatches(false);
+        auto nextRetry = fireDueRetries();
+        if (nextRetry && (!nextFlush || *nextRetry < *nextFlush))
+            nextFlush = nextRetry;
     }
 
+    // Anything already accepted into a batch still goes out
+    flushDueBatches(true);
     log_.info("Relayer '" + name_ + "' run loop finished");
 }
 
+void Relayer::observeQueueWait(std::chrono::steady_clock::time_point queuedAt)
+{
+    auto waited = std::chrono::steady_clock::now() - queuedAt;
+    queueWaitNanos_ += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count());
+    dequeued_++;
+}
+
+void Relayer::process(const IBCPacket &pkt)
+{
+    const bool isData = pkt.type == IBCPacketType::Data;
+    log_.info(std::string(isData ? "Relaying packet" : "Relaying ack") + " from " + pkt.srcChain + " to " +
+              pkt.dstChain + " (seq=" + std::to_string(pkt.sequence) + ")");
+
+    // Another relayer already took this one (Competition, or a handoff)
+    if (coordinator_ && !coordinator_->claim(pkt))
+    {
+        metrics_.incCounter("relayer_duplicates_cancelled");
+        log_.debug("Cancelled duplicate relay of seq=" + std::to_string(pkt.sequence));
+        return;
+    }
+
+    dispatch(pkt, 0);
+}
+
+// Sends pkt (directly or via its destination's batch); attempt > 0 for resends
+void Relayer::dispatch(const IBCPacket &pkt, uint32_t attempt)
+{
+    if (batchParams_.maxPackets > 1)
+    {
+        addToBatch(pkt, attempt);
+        return;
+    }
+
+    EndpointHandle toAddr;
+    Status s = routeFor(pkt, toAddr, attempt);
+    if (s.ok())
+    {
+        // Send full serialized IBCPacket, not just payload
+        s = sendToChain(toAddr, NodeMessageKind::IBC, serializeIBCPacket(pkt));
+    }
+    if (s.ok())
+        onRelayed(pkt);
+    else
+        onRelayFailed(pkt, s);
+}
+
+void Relayer::onRelayed(const IBCPacket &pkt)
+{
+    const bool isData = pkt.type == IBCPacketType::Data;
+    if (isData)
+    {
+        packetsRelayed_++;
+        metrics_.incCounter("relayer_packets_relayed");
+        log_.debug("Successfully relayed packet seq=" + std::to_string(pkt.sequence));
+    }
+    else
+    {
+        acksRelayed_++;
+        metrics_.incCounter("relayer_acks_relayed");
+        log_.debug("Successfully relayed ack seq=" + std::to_string(pkt.sequence));
+    }
+
+    // Detailed IBC event logging
+    if (detailedLogger_)
+    {
+        detailedLogger_->logIBCEvent(
+            isData ? IBCEventType::PacketRelayed : IBCEventType::AckRelayed,
+            pkt.srcChain,
+            pkt.dstChain,
+            pkt.srcPort.value,
+            pkt.srcChannel.value,
+            pkt.dstPort.value,
+            pkt.dstChannel.value,
+            pkt.sequence,
+            pkt.payload,
+            name_
+        );
+    }
+
+    logRelayerState(isData ? "packet_relayed" : "ack_relayed", "seq=" + std::to_string(pkt.sequence));
+
+    // Data stays in flight until its ack shows up; a sent ack is done
+    if (isData)
+        trackInFlight(pkt, true);
+    else
+        clearInFlight(inFlightKey(pkt));
+}
+
+void Relayer::onRelayFailed(const IBCPacket &pkt, const Status &s)
+{
+    const bool isData = pkt.type == IBCPacketType::Data;
+    failures_++;
+    metrics_.incCounter(isData ? "relayer_packets_failed" : "relayer_acks_failed");
+    log_.warn(std::string(isData ? "Failed to relay packet: " : "Failed to relay ack: ") + s.message);
+    logRelayerState(isData ? "packet_failed" : "ack_failed", s.message);
+
+    // Drops are transient and worth another try; a missing route is not
+    if (s.code == ErrorCode::NetworkDrop)
+        trackInFlight(pkt, false);
+    else
+        clearInFlight(inFlightKey(pkt));
+
+    // The source chain treats a dropped data packet as congestion
+    if (isData && s.code == ErrorCode::NetworkDrop && bus_.hasSubscribers(EventKind::NetworkDrop))
+    {
+        bus_.publish(Event{EventKind::NetworkDrop, pkt.srcChain, name_, s.message,
+                           std::make_shared<const IBCPacket>(pkt)});
+    }
+}
+
 void Relayer::onIBCPacketSendEvent(const Event &e)
 {
-    try {
-        IBCPacket pkt = deserializeIBCPacket(e.detail);
+    const IBCPacket *pkt = e.packet();
+    if (!pkt) {
+        log_.error("IBCPacketSend event without packet payload");
+        metrics_.incCounter("relayer_malformed_events");
+        return;
+    }
 
-        // Only relay Data packets (not Acks)
-        if (pkt.type == IBCPacketType::Data) {
-            pendingPackets_.push(pkt);
-            log_.debug("Queued IBC packet from " + pkt.srcChain +
-                       " to " + pkt.dstChain + " (seq=" +
-                       std::to_string(pkt.sequence) + ")");
-            metrics_.incCounter("relayer_packets_queued");
-        }
-    } catch (const std::exception& ex) {
-        log_.error("Failed to deserialize IBCPacket: " +
-                   std::string(ex.what()));
-        metrics_.incCounter("relayer_deserialization_errors");
+    if (!isAssigned(*pkt))
+        return;
+
+    // Only relay Data packets (not Acks)
+    if (pkt->type == IBCPacketType::Data) {
+        if (!enqueue(inboxPackets_, *pkt))
+            return; // relayer stopped
+        log_.debug("Queued IBC packet from " + pkt->srcChain +
+                   " to " + pkt->dstChain + " (seq=" +
+                   std::to_string(pkt->sequence) + ")");
+        metrics_.incCounter("relayer_packets_queued");
     }
 }
 
 void Relayer::onIBCAckSendEvent(const Event &e)
 {
-    try {
-        IBCPacket ack = deserializeIBCPacket(e.detail);
+    const IBCPacket *ack = e.packet();
+    if (!ack) {
+        log_.error("IBCAckSend event without packet payload");
+        metrics_.incCounter("relayer_malformed_events");
+        return;
+    }
 
-        if (ack.type == IBCPacketType::Ack) {
-            pendingAcks_.push(ack);
-            log_.debug("Queued IBC ack from " + ack.srcChain +
-                       " to " + ack.dstChain + " (seq=" +
-                       std::to_string(ack.sequence) + ")");
-            metrics_.incCounter("relayer_acks_queued");
-        }
-    } catch (const std::exception& ex) {
-        log_.error("Failed to deserialize IBCAck: " +
-                   std::string(ex.what()));
-        metrics_.incCounter("relayer_deserialization_errors");
+    // The ack proves the data packets arrived, whichever relayer carried them
+    for (uint64_t seq : ackedSequences(*ack)) {
+        onAcked(inFlightKey(ack->dstChain, ack->dstPort.value, ack->dstChannel.value,
+                            seq, IBCPacketType::Data));
+    }
+
+    if (!isAssigned(*ack))
+        return;
+
+    if (ack->type == IBCPacketType::Ack) {
+        if (!enqueue(inboxAcks_, *ack))
+            return; // relayer stopped
+        log_.debug("Queued IBC ack from " + ack->srcChain +
+                   " to " + ack->dstChain + " (seq=" +
+                   std::to_string(ack->sequence) + ")");
+        metrics_.incCounter("relayer_acks_queued");
+    }
+}
+
+// The receiver is stuck on a gap: if we carried the missing packet, resend it
+// now instead of at its timer
+void Relayer::onResendRequestEvent(const Event &e)
+{
+    const IBCPacket *missing = e.packet();
+    if (!missing)
+        return;
+
+    std::string key = inFlightKey(*missing);
+    {
+        std::lock_guard<std::mutex> lock(inFlightMtx_);
+        auto it = inFlight_.find(key);
+        if (it == inFlight_.end() || it->second.generation == 0)
+            return; // not ours, or a resend is already under way
+        InFlight &entry = it->second;
+        entry.due = std::chrono::steady_clock::now();
+        entry.generation = nextGeneration_++;
+        retryHeap_.push(RetryTimer{entry.due, key, entry.generation});
+    }
+    metrics_.incCounter("relayer_resend_requests_served");
+    {
+        std::lock_guard<std::mutex> lock(inboxMtx_);
+        retryKick_ = true;
+    }
+    inboxCV_.notify_one();
+}
+
+// The source gave up on the packet; resending it is pointless
+void Relayer::onPacketTimeoutEvent(const Event &e)
+{
+    if (const IBCPacket *pkt = e.packet())
+        clearInFlight(inFlightKey(*pkt));
+}
+
+// Another relayer owns pkt under the coordinator's assignment
+bool Relayer::isAssigned(const IBCPacket &pkt)
+{
+    if (!coordinator_ || coordinator_->isAssigned(name_, pkt))
+        return true;
+    metrics_.incCounter("relayer_packets_skipped");
+    return false;
+}
+
+void Relayer::recordEventQueueMetrics()
+{
+    for (auto [token, kind] : {std::pair{packetSendToken_, "packet"}, std::pair{ackSendToken_, "ack"}})
+    {
+        auto st = bus_.stats(token);
+        if (!st)
+            continue;
+        std::string prefix = std::string("relayer_event_queue_") + kind + "_";
+        metrics_.setGauge(prefix + "high_water", static_cast<double>(st->highWater));
+        metrics_.setGauge(prefix + "max_lag_us", static_cast<double>(st->maxLag.count()));
+        metrics_.incCounter(prefix + "dropped", static_cast<double>(st->dropped));
     }
 }
 
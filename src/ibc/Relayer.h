@@ -6,31 +6,74 @@
 #include <mutex>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <optional>
+#include <unordered_map>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <queue>
 #include "IBCTypes.h"
 #include "util/Error.h"
 #include "net/Transport.h"
 #include "core/EventBus.h"
-#include "util/ConcurrentQueue.h"
 #include "util/Logger.h"
 #include "util/Metrics.h"
+#include "util/Rng.h"
 
 // Forward declaration
 class DetailedLogger;
+class RelayerCoordinator;
+enum class NodeMessageKind;
+
+// Relay batching: packets and acks for the same destination chain travel in
+// one message, sent when full or when the oldest has waited maxDelay
+struct RelayBatchParams
+{
+    size_t maxPackets{1}; // 1 = no batching
+    std::chrono::milliseconds maxDelay{5};
+};
+
+// Retries: a relayed packet stays in flight until its ack is seen; without
+// one by ackTimeout, or after a failed send, it is resent with jittered
+// exponential backoff
+struct RelayRetryParams
+{
+    std::chrono::milliseconds ackTimeout{1000};
+    std::chrono::milliseconds baseBackoff{100};
+    std::chrono::milliseconds maxBackoff{5000};
+    uint32_t maxAttempts{8};   // resends before giving up; 0 only tracks ack round trips
+    size_t maxInFlight{4096};  // memory budget; further packets are not tracked
+};
+
+// Re-proves a data packet against its source chain's latest header, so a
+// resend is not checked against a header the destination has pruned; false
+// once the source no longer commits to the packet (acked or timed out)
+using ProofRefresher = std::function<bool(IBCPacket &)>;
 
 class Relayer
 {
 public:
-    Relayer(Transport &transport, EventBus &bus, const std::string &name, Logger &log, MetricsSink &metrics, DetailedLogger* detailedLogger = nullptr);
+    Relayer(Transport &transport, EventBus &bus, const std::string &name, Logger &log, MetricsSink &metrics, DetailedLogger* detailedLogger = nullptr, RngStream rng = RngStream());
     ~Relayer();
 
-    Status connectChainMailbox(const std::string &chainId, const std::string &address);
+    Status connectChainMailbox(const std::string &chainId, const std::string &address); // call before start()
     Status relayPacket(const IBCPacket &pkt);    // data
     Status relayAck(const IBCPacket &ackPacket); // ack
     void setDropOnRoute(double probability);     // additional route drop
+    void setBatching(const RelayBatchParams &params); // call before start()
+    void setCoordinator(RelayerCoordinator *coordinator); // call before start(); null = relay everything
+    void setRetry(const RelayRetryParams &params);        // call before start()
+    void setProofRefresher(ProofRefresher refresher);     // call before start(); unset keeps sent proofs
 
     // Thread lifecycle
     Status start();
-    void stop();
+    void stop();   // queued packets are dropped
+    void retire(); // leaves the coordinator, relays what is queued, then stops
+    // After retire(): the packets still waiting for an ack, which only their
+    // relayer resends, for another one to adopt; empties our table
+    std::vector<IBCPacket> takeUnacked();
+    void adoptUnacked(const std::vector<IBCPacket> &pkts); // resent at once, then retried as ours
 
     // Get relayer ID
     std::string getRelayerId() const { return name_; }
@@ -39,11 +82,65 @@ public:
     uint64_t getPacketsRelayed() const { return packetsRelayed_; }
     uint64_t getAcksRelayed() const { return acksRelayed_; }
     uint64_t getFailures() const { return failures_; }
+    size_t getInFlight() const;
+    size_t getBacklog();                                      // packets and acks waiting in the inbox
+    uint64_t getDequeued() const { return dequeued_; }        // taken off the inbox so far
+    uint64_t getQueueWaitNanos() const { return queueWaitNanos_; } // their summed inbox wait
 
 private:
     void runLoop(); // Main relayer thread loop
+    void shutdown(bool drain);
+    struct Inbound
+    {
+        IBCPacket pkt;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+    struct PendingBatch
+    {
+        EndpointHandle to{0};
+        std::vector<IBCPacket> items;
+        std::chrono::steady_clock::time_point deadline{};
+    };
+
+    struct InFlight
+    {
+        IBCPacket pkt;
+        uint32_t attempts{0}; // resends so far
+        std::chrono::steady_clock::time_point firstTried{}; // start of the ack round trip
+        std::chrono::steady_clock::time_point due{};
+        uint64_t generation{0}; // matches the live retryHeap_ entry
+    };
+    struct RetryTimer
+    {
+        std::chrono::steady_clock::time_point due;
+        std::string key;
+        uint64_t generation;
+        bool operator>(const RetryTimer &o) const { return due > o.due; }
+    };
+
+    void process(const IBCPacket &pkt); // data or ack
+    void dispatch(const IBCPacket &pkt, uint32_t attempt);
+    void onRelayed(const IBCPacket &pkt);
+    void onRelayFailed(const IBCPacket &pkt, const Status &s);
+    Status routeFor(const IBCPacket &pkt, EndpointHandle &toAddr, uint32_t attempt = 0);
+    Status sendToChain(EndpointHandle toAddr, NodeMessageKind kind, std::string bytes);
+    void addToBatch(const IBCPacket &pkt, uint32_t attempt);
+    void flushBatch(PendingBatch &batch);
+    std::optional<std::chrono::steady_clock::time_point> flushDueBatches(bool all);
+    bool enqueue(std::deque<Inbound> &queue, const IBCPacket &pkt); // false once stopped
+    void observeQueueWait(std::chrono::steady_clock::time_point queuedAt);
+    void trackInFlight(const IBCPacket &pkt, bool sent);
+    void clearInFlight(const std::string &key);
+    void onAcked(const std::string &key);
+    std::optional<std::chrono::steady_clock::time_point> fireDueRetries();
+    std::chrono::steady_clock::duration backoff(const std::string &key, uint32_t attempts);
     void onIBCPacketSendEvent(const Event &e);
     void onIBCAckSendEvent(const Event &e);
+    void onResendRequestEvent(const Event &e);
+    void onPacketTimeoutEvent(const Event &e);
+    void subscribeEvents();
+    bool isAssigned(const IBCPacket &pkt);
+    void recordEventQueueMetrics(); // bus subscription depth and lag
     void logRelayerState(const std::string& event_type, const std::string& additional_data = "");
 
     Transport &transport_;
@@ -53,23 +150,45 @@ private:
     MetricsSink &metrics_;
     DetailedLogger* detailedLogger_;
 
-    std::unordered_map<std::string, std::string> chainAddr_;
-    std::mt19937 rng_;
+    EndpointHandle endpoint_{0};                              // our own sender handle
+    std::unordered_map<std::string, EndpointHandle> chainAddr_; // chainId -> mailbox handle
+    RngStream rng_;                                           // route drops, keyed per packet
     std::mutex mtx_;
     double routeDrop_{0.0};
+    RelayBatchParams batchParams_;
+    RelayerCoordinator *coordinator_{nullptr}; // shared with the other relayers
+    std::unordered_map<std::string, PendingBatch> batches_; // by dstChain; worker thread only
+    RelayRetryParams retryParams_;
+    ProofRefresher proofRefresher_;
+
+    // In-flight table keyed by (channel, sequence, kind); acks clear data
+    // entries from the bus thread, so it has its own lock
+    mutable std::mutex inFlightMtx_;
+    std::unordered_map<std::string, InFlight> inFlight_;
+    std::priority_queue<RetryTimer, std::vector<RetryTimer>, std::greater<RetryTimer>> retryHeap_;
+    uint64_t nextGeneration_{1};
 
     // Threading infrastructure
     std::thread worker_;
     std::atomic<bool> running_{false};
-    ConcurrentQueue<IBCPacket> pendingPackets_;
-    ConcurrentQueue<IBCPacket> pendingAcks_;
+    // Inbox: both queues share one lock and one wakeup
+    std::mutex inboxMtx_;
+    std::condition_variable inboxCV_;
+    std::deque<Inbound> inboxPackets_;
+    std::deque<Inbound> inboxAcks_;
+    bool inboxClosed_{false}; // set by stop()
+    bool retryKick_{false};   // a retry timer moved earlier
 
     // Event subscriptions
     int packetSendToken_{-1};
     int ackSendToken_{-1};
+    int resendToken_{-1};
+    int timeoutToken_{-1};
 
     // Statistics
     std::atomic<uint64_t> packetsRelayed_{0};
     std::atomic<uint64_t> acksRelayed_{0};
     std::atomic<uint64_t> failures_{0};
+    std::atomic<uint64_t> dequeued_{0};
+    std::atomic<uint64_t> queueWaitNanos_{0};
 };
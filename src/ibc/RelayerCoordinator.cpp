@@ -0,0 +1,344 @@
+#include "RelayerCoordinator.h"
+#include "util/Rng.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Ordering domain of a packet: its source chain, port and channel
+    std::string channelKey(const IBCPacket &pkt)
+    {
+        return pkt.srcChain + "/" + pkt.srcPort.value + "/" + pkt.srcChannel.value;
+    }
+
+    std::string packetKey(const IBCPacket &pkt)
+    {
+        return channelKey(pkt) + "#" + std::to_string(pkt.sequence) +
+               (pkt.type == IBCPacketType::Data ? "d" : "a");
+    }
+}
+
+RelayerCoordinator::RelayerCoordinator(CoordinatorParams params)
+    : params_(params)
+{
+    params_.virtualNodes = std::max<size_t>(1, params_.virtualNodes);
+    params_.claimMemory = std::max<size_t>(1, params_.claimMemory);
+    params_.backlogScale = std::max<size_t>(1, params_.backlogScale);
+}
+
+void RelayerCoordinator::join(const std::string &relayerId)
+{
+    std::unique_lock<std::shared_mutex> lock(membersMtx_);
+    auto &members = current_.members;
+    auto it = std::lower_bound(members.begin(), members.end(), relayerId);
+    if (it != members.end() && *it == relayerId)
+        return;
+    View old = current_;
+    members.insert(it, relayerId);
+    rebuildLocked();
+    retireLocked(std::move(old));
+}
+
+void RelayerCoordinator::leave(const std::string &relayerId)
+{
+    {
+        std::unique_lock<std::shared_mutex> lock(membersMtx_);
+        auto &members = current_.members;
+        auto it = std::lower_bound(members.begin(), members.end(), relayerId);
+        if (it == members.end() || *it != relayerId)
+            return;
+        View old = current_;
+        members.erase(it);
+        rebuildLocked();
+        retireLocked(std::move(old));
+    }
+    {
+        std::lock_guard<std::mutex> lock(healthMtx_);
+        health_.erase(relayerId);
+    }
+
+    // Its leases are free immediately instead of at expiry
+    std::lock_guard<std::mutex> lock(leasesMtx_);
+    for (auto it = leases_.begin(); it != leases_.end();)
+    {
+        if (it->second.holder == relayerId)
+            it = leases_.erase(it);
+        else
+            ++it;
+    }
+}
+
+bool RelayerCoordinator::isAssigned(const std::string &relayerId, const IBCPacket &pkt)
+{
+    switch (params_.mode)
+    {
+    case RelayerAssignment::Competition:
+        return true;
+
+    case RelayerAssignment::LatencyWeighted:
+    {
+        maybeReweigh();
+        std::string owner = ownerOf(pkt);
+        if (owner.empty() || owner == relayerId)
+            return true; // empty: nobody had joined yet
+        // The owner left before taking it: any member may, claim() keeps one
+        std::shared_lock<std::shared_mutex> lock(membersMtx_);
+        const auto &members = current_.members;
+        return !std::binary_search(members.begin(), members.end(), owner);
+    }
+
+    case RelayerAssignment::ConsistentHash:
+    case RelayerAssignment::RoundRobin:
+    {
+        std::shared_lock<std::shared_mutex> lock(membersMtx_);
+        if (ownsLocked(current_, relayerId, pkt))
+            return true;
+        auto now = std::chrono::steady_clock::now();
+        for (const View &v : previous_)
+        {
+            if (now < v.until && ownsLocked(v, relayerId, pkt))
+                return true;
+        }
+        return false;
+    }
+
+    case RelayerAssignment::Lease:
+    {
+        {
+            // A relayer that has left must not pick up leases; right after a
+            // change every member takes the packet and claim() picks one
+            std::shared_lock<std::shared_mutex> lock(membersMtx_);
+            const auto &members = current_.members;
+            if (!members.empty() && !std::binary_search(members.begin(), members.end(), relayerId))
+                return false;
+            if (!previous_.empty() && std::chrono::steady_clock::now() < previous_.back().until)
+                return true;
+        }
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(leasesMtx_);
+        Lease &lease = leases_[channelKey(pkt)];
+        if (lease.holder.empty() || lease.expiresAt <= now)
+        {
+            lease.holder = relayerId; // free or expired: fail over to us
+        }
+        if (lease.holder != relayerId)
+            return false;
+        lease.expiresAt = now + params_.leaseTtl;
+        return true;
+    }
+    }
+    return true;
+}
+
+bool RelayerCoordinator::claim(const IBCPacket &pkt)
+{
+    std::string key = packetKey(pkt);
+    std::lock_guard<std::mutex> lock(claimsMtx_);
+    if (!claimed_.insert(key).second)
+        return false;
+    claimOrder_.push_back(std::move(key));
+    if (claimOrder_.size() > params_.claimMemory)
+    {
+        claimed_.erase(claimOrder_.front());
+        claimOrder_.pop_front();
+    }
+    return true;
+}
+
+void RelayerCoordinator::reportRoundTrip(const std::string &relayerId, std::chrono::steady_clock::duration rtt)
+{
+    double ms = std::chrono::duration<double, std::milli>(rtt).count();
+    std::lock_guard<std::mutex> lock(healthMtx_);
+    Health &h = health_[relayerId];
+    h.rttMs = h.rttMs == 0.0 ? ms : (1.0 - params_.rttAlpha) * h.rttMs + params_.rttAlpha * ms;
+}
+
+void RelayerCoordinator::reportBacklog(const std::string &relayerId, size_t backlog)
+{
+    std::lock_guard<std::mutex> lock(healthMtx_);
+    health_[relayerId].backlog = backlog;
+}
+
+double RelayerCoordinator::weight(const std::string &relayerId) const
+{
+    std::shared_lock<std::shared_mutex> lock(membersMtx_);
+    const auto &members = current_.members;
+    auto it = std::lower_bound(members.begin(), members.end(), relayerId);
+    if (it == members.end() || *it != relayerId)
+        return 0.0;
+    size_t i = static_cast<size_t>(it - members.begin());
+    if (current_.weights.size() != members.size())
+        return 1.0 / members.size();
+    double total = 0.0;
+    for (double w : current_.weights)
+        total += w;
+    return current_.weights[i] / total;
+}
+
+// Recomputes weights once per reweighInterval. Packets already decided keep
+// their owner, so no handoff window is needed.
+void RelayerCoordinator::maybeReweigh()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now.time_since_epoch().count() < nextReweigh_.load(std::memory_order_relaxed))
+        return;
+    std::unique_lock<std::shared_mutex> lock(membersMtx_);
+    if (now.time_since_epoch().count() < nextReweigh_.load(std::memory_order_relaxed))
+        return; // another relayer got here first
+    nextReweigh_.store((now + params_.reweighInterval).time_since_epoch().count(), std::memory_order_relaxed);
+    rebuildLocked();
+}
+
+// LatencyWeighted: the first relayer to ask about a packet fixes its owner
+// from the weights of that moment; the others get the same answer however
+// late their copy of the event arrives, so this mode needs no handoff window
+std::string RelayerCoordinator::ownerOf(const IBCPacket &pkt)
+{
+    std::string key = packetKey(pkt);
+    {
+        std::lock_guard<std::mutex> lock(decisionsMtx_);
+        auto it = decisions_.find(key);
+        if (it != decisions_.end())
+            return it->second;
+    }
+
+    std::string owner;
+    {
+        std::shared_lock<std::shared_mutex> lock(membersMtx_);
+        if (const std::string *o = weightedOwnerLocked(current_, pkt))
+            owner = *o;
+    }
+
+    std::lock_guard<std::mutex> lock(decisionsMtx_);
+    auto [it, inserted] = decisions_.emplace(key, owner);
+    if (inserted)
+    {
+        decisionOrder_.push_back(std::move(key));
+        if (decisionOrder_.size() > params_.claimMemory)
+        {
+            decisions_.erase(decisionOrder_.front());
+            decisionOrder_.pop_front();
+        }
+    }
+    return it->second; // a racing relayer may have decided first
+}
+
+// Weighted rendezvous hashing: every member draws a score for the packet and
+// the highest wins, so a member wins in proportion to its weight
+const std::string *RelayerCoordinator::weightedOwnerLocked(const View &view, const IBCPacket &pkt) const
+{
+    if (view.members.empty())
+        return nullptr;
+    if (view.weights.size() != view.members.size())
+        return &view.members.front();
+
+    uint64_t key = stableHash(channelKey(pkt)) ^
+                   splitmix64(pkt.sequence * 2 + (pkt.type == IBCPacketType::Data ? 0 : 1));
+    size_t best = 0;
+    double bestScore = -1.0;
+    for (size_t i = 0; i < view.members.size(); ++i)
+    {
+        // u in (0, 1]; -w / ln(u) is exponential with rate 1/w
+        double u = (static_cast<double>(splitmix64(key ^ stableHash(view.members[i])) >> 11) + 1.0) * 0x1.0p-53;
+        double score = u >= 1.0 ? HUGE_VAL : -view.weights[i] / std::log(u);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = i;
+        }
+    }
+    return &view.members[best];
+}
+
+bool RelayerCoordinator::ownsLocked(const View &view, const std::string &relayerId, const IBCPacket &pkt) const
+{
+    if (params_.mode == RelayerAssignment::ConsistentHash)
+    {
+        if (view.ring.empty())
+            return true;
+        auto it = view.ring.lower_bound(stableHash(channelKey(pkt)));
+        if (it == view.ring.end())
+            it = view.ring.begin();
+        return it->second == relayerId;
+    }
+
+    if (view.members.empty())
+        return true;
+
+    if (params_.mode == RelayerAssignment::LatencyWeighted)
+    {
+        const std::string *owner = weightedOwnerLocked(view, pkt);
+        return owner && *owner == relayerId;
+    }
+
+    // Offset by channel so channels do not all start on the same relayer
+    size_t owner = (stableHash(channelKey(pkt)) + pkt.sequence) % view.members.size();
+    return view.members[owner] == relayerId;
+}
+
+void RelayerCoordinator::retireLocked(View old)
+{
+    auto now = std::chrono::steady_clock::now();
+    while (!previous_.empty() && previous_.front().until <= now)
+    {
+        previous_.pop_front();
+    }
+    old.until = now + params_.handoffGrace;
+    previous_.push_back(std::move(old));
+}
+
+void RelayerCoordinator::rebuildLocked()
+{
+    current_.ring.clear();
+    current_.weights.clear();
+
+    if (params_.mode == RelayerAssignment::ConsistentHash)
+    {
+        for (const auto &id : current_.members)
+        {
+            for (size_t v = 0; v < params_.virtualNodes; ++v)
+            {
+                current_.ring.emplace(splitmix64(stableHash(id) ^ v), id);
+            }
+        }
+        return;
+    }
+
+    if (params_.mode != RelayerAssignment::LatencyWeighted || current_.members.empty())
+        return;
+
+    // Cost = ack RTT, scaled up by backlog; relayers without a sample yet are
+    // assumed average. Weight = 1 / cost, floored so slow relayers still get
+    // enough packets to notice when they recover.
+    std::vector<double> cost(current_.members.size(), 0.0);
+    {
+        std::lock_guard<std::mutex> lock(healthMtx_);
+        double knownSum = 0.0;
+        size_t known = 0;
+        for (size_t i = 0; i < cost.size(); ++i)
+        {
+            auto it = health_.find(current_.members[i]);
+            if (it != health_.end() && it->second.rttMs > 0.0)
+            {
+                cost[i] = it->second.rttMs;
+                knownSum += cost[i];
+                known++;
+            }
+        }
+        double fallback = known ? knownSum / known : 1.0;
+        for (size_t i = 0; i < cost.size(); ++i)
+        {
+            if (cost[i] == 0.0)
+                cost[i] = fallback;
+            auto it = health_.find(current_.members[i]);
+            size_t backlog = it != health_.end() ? it->second.backlog : 0;
+            cost[i] *= 1.0 + static_cast<double>(backlog) / params_.backlogScale;
+        }
+    }
+
+    double best = 0.0;
+    for (double c : cost)
+        best = std::max(best, 1.0 / c);
+    for (double c : cost)
+        current_.weights.push_back(std::max(1.0 / c, best * params_.minWeightShare));
+}
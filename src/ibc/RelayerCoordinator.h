@@ -0,0 +1,112 @@
+// ibc/RelayerCoordinator.h
+// Decides which relayer relays each packet, so a packet goes out once.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "IBCTypes.h"
+
+enum class RelayerAssignment
+{
+    ConsistentHash,  // channel -> relayer on a hash ring; keeps a channel on one relayer
+    RoundRobin,      // consecutive sequences rotate over the live relayers
+    Lease,           // first relayer to see a channel leases it; others take over on expiry
+    Competition,     // every relayer races; the first to claim a packet sends it
+    LatencyWeighted  // packets spread by each relayer's ack round trip and backlog
+};
+
+struct CoordinatorParams
+{
+    RelayerAssignment mode{RelayerAssignment::ConsistentHash};
+    std::chrono::milliseconds leaseTtl{500}; // Lease: renewed on every packet
+    size_t virtualNodes{64};                 // ConsistentHash: ring points per relayer
+    size_t claimMemory{1 << 16};             // claims (and LatencyWeighted owners) remembered
+    std::chrono::milliseconds handoffGrace{1000}; // after a membership change, old owners still relay
+    std::chrono::milliseconds reweighInterval{200}; // LatencyWeighted: weights are fixed in between
+    double rttAlpha{0.2};                    // LatencyWeighted: EWMA weight of a new round trip
+    size_t backlogScale{32};                 // LatencyWeighted: queued packets that double a relayer's cost
+    double minWeightShare{0.05};             // LatencyWeighted: floor relative to the best relayer
+};
+
+// Shared by all relayers of a simulation. Relayers join when they start and
+// leave when they stop; their channels then fail over to the others. Each
+// relayer checks assignment when its copy of an event comes off the bus, so
+// for handoffGrace after a change both the old and the new owner accept a
+// packet and claim() keeps only one of them.
+class RelayerCoordinator
+{
+public:
+    explicit RelayerCoordinator(CoordinatorParams params = {});
+
+    void join(const std::string &relayerId);
+    void leave(const std::string &relayerId);
+
+    // Whether relayerId should pick up pkt at all (always true for Competition)
+    bool isAssigned(const std::string &relayerId, const IBCPacket &pkt);
+    // True for the first relayer to claim pkt; the others cancel their copy
+    // before sending
+    bool claim(const IBCPacket &pkt);
+
+    // LatencyWeighted inputs: the ack round trip of a packet relayerId sent,
+    // and its inbox depth
+    void reportRoundTrip(const std::string &relayerId, std::chrono::steady_clock::duration rtt);
+    void reportBacklog(const std::string &relayerId, size_t backlog);
+    double weight(const std::string &relayerId) const; // share of new packets, 0 if not a member
+
+    RelayerAssignment mode() const { return params_.mode; }
+
+private:
+    // Who is in and how packets are split between them
+    struct View
+    {
+        std::vector<std::string> members;     // sorted
+        std::map<uint64_t, std::string> ring; // ConsistentHash
+        std::vector<double> weights;          // LatencyWeighted, parallel to members
+        std::chrono::steady_clock::time_point until{}; // end of its handoff window
+    };
+    struct Lease
+    {
+        std::string holder;
+        std::chrono::steady_clock::time_point expiresAt{};
+    };
+    struct Health
+    {
+        double rttMs{0.0}; // 0 until the first ack
+        size_t backlog{0};
+    };
+
+    void rebuildLocked();     // ring and weights of current_
+    void retireLocked(View old); // keeps a replaced view valid for the handoff window
+    void maybeReweigh();
+    std::string ownerOf(const IBCPacket &pkt); // LatencyWeighted, memoized
+    const std::string *weightedOwnerLocked(const View &view, const IBCPacket &pkt) const;
+    bool ownsLocked(const View &view, const std::string &relayerId, const IBCPacket &pkt) const;
+
+    CoordinatorParams params_;
+
+    mutable std::shared_mutex membersMtx_;
+    View current_;
+    std::deque<View> previous_; // views still in their handoff window, oldest first
+    std::atomic<std::chrono::steady_clock::rep> nextReweigh_{0};
+
+    mutable std::mutex healthMtx_; // taken after membersMtx_
+    std::unordered_map<std::string, Health> health_;
+
+    std::mutex leasesMtx_;
+    std::unordered_map<std::string, Lease> leases_; // by channel key
+
+    std::mutex decisionsMtx_;
+    std::unordered_map<std::string, std::string> decisions_; // LatencyWeighted: packet -> owner
+    std::deque<std::string> decisionOrder_;                  // oldest first, bounds decisions_
+
+    std::mutex claimsMtx_;
+    std::unordered_set<std::string> claimed_;
+    std::deque<std::string> claimOrder_; // oldest first, bounds claimed_
+};
@@ -0,0 +1,181 @@
+#include "RelayerPool.h"
+#include <algorithm>
+
+RelayerPool::RelayerPool(RelayerFactory factory, RelayerPoolParams params, Logger &log, MetricsSink &metrics)
+    : factory_(std::move(factory)), params_(params), log_(log), metrics_(metrics)
+{
+    params_.minRelayers = std::max<size_t>(1, params_.minRelayers);
+    params_.maxRelayers = std::max(params_.minRelayers, params_.maxRelayers);
+}
+
+RelayerPool::~RelayerPool()
+{
+    stop();
+}
+
+Status RelayerPool::start(size_t initial)
+{
+    {
+        std::lock_guard<std::mutex> lock(ctlMtx_);
+        if (running_)
+            return {ErrorCode::InvalidState, "Relayer pool already running"};
+        running_ = true;
+    }
+
+    if (params_.elastic)
+    {
+        initial = std::clamp(initial, params_.minRelayers, params_.maxRelayers);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        while (members_.size() < initial)
+        {
+            Status s = growLocked();
+            if (!s.ok())
+                return s;
+        }
+        lastResize_ = std::chrono::steady_clock::now();
+        metrics_.setGauge("relayer_pool_size", static_cast<double>(members_.size()));
+    }
+
+    if (params_.elastic)
+    {
+        controller_ = std::thread([this]() { controlLoop(); });
+    }
+    return {ErrorCode::Ok, ""};
+}
+
+void RelayerPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(ctlMtx_);
+        if (!running_)
+            return;
+        running_ = false;
+    }
+    ctlCV_.notify_all();
+    if (controller_.joinable())
+    {
+        controller_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto &m : members_)
+    {
+        m.relayer->stop();
+    }
+}
+
+size_t RelayerPool::size() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return members_.size();
+}
+
+void RelayerPool::controlLoop()
+{
+    std::unique_lock<std::mutex> lock(ctlMtx_);
+    while (running_)
+    {
+        ctlCV_.wait_for(lock, params_.evalInterval, [this] { return !running_; });
+        if (!running_)
+            break;
+        lock.unlock();
+        evaluate();
+        lock.lock();
+    }
+}
+
+// Samples backlog and the mean inbox wait since the previous sample, then
+// adds a relayer when either exceeds its target and retires one when both
+// are well below
+void RelayerPool::evaluate()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    size_t backlog = 0;
+    uint64_t dequeued = 0;
+    uint64_t waitNanos = 0;
+    for (auto &m : members_)
+    {
+        backlog += m.relayer->getBacklog();
+        uint64_t d = m.relayer->getDequeued();
+        uint64_t w = m.relayer->getQueueWaitNanos();
+        dequeued += d - m.lastDequeued;
+        waitNanos += w - m.lastWaitNanos;
+        m.lastDequeued = d;
+        m.lastWaitNanos = w;
+    }
+
+    // Nothing dequeued while work is waiting means the wait is at least one interval
+    double sampleMs = dequeued > 0   ? static_cast<double>(waitNanos) / dequeued / 1e6
+                      : backlog > 0 ? static_cast<double>(params_.evalInterval.count())
+                                    : 0.0;
+    latencyEwmaMs_ = 0.7 * latencyEwmaMs_ + 0.3 * sampleMs;
+
+    metrics_.setGauge("relayer_pool_backlog", static_cast<double>(backlog));
+    metrics_.observe("relayer_pool_wait_ms", latencyEwmaMs_);
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastResize_ < params_.cooldown)
+        return;
+
+    const size_t n = members_.size();
+    const double slo = static_cast<double>(params_.latencySlo.count());
+    bool overloaded = latencyEwmaMs_ > slo || backlog > params_.backlogPerRelayer * n;
+    bool idle = latencyEwmaMs_ < slo / 4 && backlog * 4 < params_.backlogPerRelayer * (n - 1);
+
+    if (overloaded && n < params_.maxRelayers)
+    {
+        Status s = growLocked();
+        if (!s.ok())
+        {
+            log_.error("Relayer pool failed to grow: " + s.message);
+            return;
+        }
+        metrics_.incCounter("relayer_pool_scale_ups");
+    }
+    else if (idle && n > params_.minRelayers)
+    {
+        shrinkLocked();
+        metrics_.incCounter("relayer_pool_scale_downs");
+    }
+    else
+    {
+        return;
+    }
+    lastResize_ = now;
+    metrics_.setGauge("relayer_pool_size", static_cast<double>(members_.size()));
+    log_.info("Relayer pool resized to " + std::to_string(members_.size()) + " (backlog=" +
+              std::to_string(backlog) + ", wait_ms=" + std::to_string(latencyEwmaMs_) + ")");
+}
+
+Status RelayerPool::growLocked()
+{
+    auto relayer = factory_(nextIndex_++);
+    if (!relayer)
+        return {ErrorCode::InvalidState, "Relayer factory returned nothing"};
+    Status s = relayer->start();
+    if (!s.ok())
+        return s;
+    members_.push_back(Member{std::move(relayer), 0, 0});
+    return {ErrorCode::Ok, ""};
+}
+
+void RelayerPool::shrinkLocked()
+{
+    std::unique_ptr<Relayer> relayer = std::move(members_.back().relayer);
+    members_.pop_back();
+    relayer->retire();
+
+    // Only the relayer holding a packet resends it, so its unacked ones are
+    // spread over the survivors rather than dropped with it
+    std::vector<IBCPacket> unacked = relayer->takeUnacked();
+    if (unacked.empty() || members_.empty())
+        return;
+    std::vector<std::vector<IBCPacket>> shares(members_.size());
+    for (size_t i = 0; i < unacked.size(); ++i)
+        shares[i % shares.size()].push_back(std::move(unacked[i]));
+    for (size_t i = 0; i < members_.size(); ++i)
+        members_[i].relayer->adoptUnacked(shares[i]);
+    metrics_.incCounter("relayer_pool_handoffs", static_cast<double>(unacked.size()));
+}
@@ -0,0 +1,73 @@
+// ibc/RelayerPool.h
+// Elastic set of relayers, grown and shrunk with backlog and relay latency.
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Relayer.h"
+#include "util/Error.h"
+#include "util/Logger.h"
+#include "util/Metrics.h"
+
+struct RelayerPoolParams
+{
+    size_t minRelayers{1};
+    size_t maxRelayers{8};
+    bool elastic{false};                         // false = stay at the initial size
+    std::chrono::milliseconds latencySlo{50};    // target inbox wait, smoothed
+    size_t backlogPerRelayer{64};                // queued packets per relayer that count as overload
+    std::chrono::milliseconds evalInterval{200}; // how often load is sampled
+    std::chrono::milliseconds cooldown{1000};    // minimum gap between two resizes
+};
+
+// Builds a configured, not yet started relayer; index is never reused
+using RelayerFactory = std::function<std::unique_ptr<Relayer>(size_t index)>;
+
+// Relayers join the coordinator when started and leave it when retired, so
+// every resize rebalances the channel assignment. Retired relayers relay
+// what they already queued before they stop, and hand the packets still
+// waiting for an ack to the survivors.
+class RelayerPool
+{
+public:
+    RelayerPool(RelayerFactory factory, RelayerPoolParams params, Logger &log, MetricsSink &metrics);
+    ~RelayerPool();
+
+    Status start(size_t initial); // elastic: clamped to [minRelayers, maxRelayers]
+    void stop();
+
+    size_t size() const;
+
+private:
+    struct Member
+    {
+        std::unique_ptr<Relayer> relayer;
+        uint64_t lastDequeued{0};  // counters at the previous sample
+        uint64_t lastWaitNanos{0};
+    };
+
+    void controlLoop();
+    void evaluate();
+    Status growLocked();
+    void shrinkLocked();
+
+    RelayerFactory factory_;
+    RelayerPoolParams params_;
+    Logger &log_;
+    MetricsSink &metrics_;
+
+    mutable std::mutex mtx_;
+    std::vector<Member> members_; // oldest first; the newest is retired first
+    size_t nextIndex_{0};
+    double latencyEwmaMs_{0.0};
+    std::chrono::steady_clock::time_point lastResize_{};
+
+    std::thread controller_;
+    std::mutex ctlMtx_;
+    std::condition_variable ctlCV_;
+    bool running_{false}; // guarded by ctlMtx_
+};
@@ -0,0 +1,39 @@
+#include "LinkModel.h"
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+LatencySampler::LatencySampler(const LatencyModel &model, unsigned seed)
+{
+    using namespace std::chrono;
+    const double baseUs = static_cast<double>(duration_cast<microseconds>(model.base).count());
+
+    if (model.dist == LatencyDist::Fixed)
+    {
+        table_.assign(1, microseconds(static_cast<int64_t>(baseUs)));
+        return;
+    }
+
+    std::mt19937 rng(seed);
+    table_.reserve(kTableSize);
+    if (model.dist == LatencyDist::Normal)
+    {
+        const double sd = static_cast<double>(duration_cast<microseconds>(model.jitter).count());
+        std::normal_distribution<double> dist(baseUs, std::max(sd, 0.0));
+        for (size_t i = 0; i < kTableSize; ++i)
+        {
+            table_.push_back(microseconds(static_cast<int64_t>(std::max(0.0, dist(rng)))));
+        }
+    }
+    else
+    {
+        // Inverse-CDF: x = scale / U^(1/alpha), U in (0, 1]
+        const double alpha = model.paretoShape > 0.0 ? model.paretoShape : 2.0;
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        for (size_t i = 0; i < kTableSize; ++i)
+        {
+            double u = 1.0 - unit(rng);
+            table_.push_back(microseconds(static_cast<int64_t>(baseUs / std::pow(u, 1.0 / alpha))));
+        }
+    }
+}
@@ -0,0 +1,56 @@
+// net/LinkModel.h
+// Per-link latency distributions, bandwidth caps and region ids.
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+using RegionId = uint16_t;
+
+enum class LatencyDist
+{
+    Fixed,
+    Normal, // base = mean, jitter = stddev (clamped at zero)
+    Pareto  // base = scale (minimum delay), paretoShape = tail index
+};
+
+struct LatencyModel
+{
+    LatencyDist dist{LatencyDist::Fixed};
+    std::chrono::milliseconds base{50};
+    std::chrono::milliseconds jitter{0};
+    double paretoShape{2.0};
+};
+
+struct LinkParams
+{
+    std::optional<LatencyModel> latency{}; // unset: region matrix, then NetworkParams
+    double bandwidthBytesPerSec{0.0};      // 0 = NetworkParams default
+    double dropRate{-1.0};                 // <0 = NetworkParams default
+};
+
+struct RegionLink
+{
+    RegionId a;
+    RegionId b;
+    LatencyModel latency;
+};
+
+// Precomputed table of latency draws; sampling is a single indexed load so
+// heavy-tailed distributions cost the same as fixed ones on the send path.
+class LatencySampler
+{
+public:
+    static constexpr size_t kTableSize = 4096;
+
+    LatencySampler(const LatencyModel &model, unsigned seed);
+
+    std::chrono::microseconds sample(uint64_t r) const
+    {
+        return table_[r % table_.size()];
+    }
+
+private:
+    std::vector<std::chrono::microseconds> table_;
+};
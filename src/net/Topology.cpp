@@ -1,54 +1,540 @@
 #include "Topology.h"
 #include <mutex>
+#include <atomic>
 #include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
 
-// Helper function to compare PeerId
-static bool peerIdEqual(const PeerId &a, const PeerId &b)
+namespace
 {
-    return a.chainId == b.chainId && a.nodeId == b.nodeId;
+    // Map key for a PeerId (chainId and nodeId joined by a unit separator)
+    std::string peerKey(const PeerId &p)
+    {
+        std::string key;
+        key.reserve(p.chainId.size() + p.nodeId.size() + 1);
+        key += p.chainId;
+        key += '\x1f';
+        key += p.nodeId;
+        return key;
+    }
+
+    // Undirected edge key with the smaller endpoint in the high half
+    uint64_t edgeKey(NodeIndex a, NodeIndex b)
+    {
+        if (a > b)
+            std::swap(a, b);
+        return (static_cast<uint64_t>(a) << 32) | b;
+    }
+
+    using EdgeList = std::vector<std::pair<NodeIndex, NodeIndex>>;
+
+    // Add n nodes and both directions of every undirected edge, then freeze
+    Status materialize(Topology &topo, const std::string &chainId, size_t n, const EdgeList &edges)
+    {
+        std::vector<NodeIndex> ids(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            auto res = topo.addNode({chainId, "node-" + std::to_string(i)});
+            if (!res.status.ok())
+                return res.status;
+            ids[i] = res.value.value();
+        }
+        for (const auto &[a, b] : edges)
+        {
+            topo.addLink(ids[a], ids[b]);
+            topo.addLink(ids[b], ids[a]);
+        }
+        topo.freeze();
+        return {ErrorCode::Ok, ""};
+    }
 }
 
 class TopologyImpl
 {
 public:
-    void addLink(const LinkSpec &link)
+    Status addLink(const LinkSpec &link)
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        links_.push_back(link);
+        if (frozen_.load(std::memory_order_relaxed))
+        {
+            return {ErrorCode::InvalidState, "Topology is frozen"};
+        }
+        NodeIndex from = internLocked(link.from);
+        NodeIndex to = internLocked(link.to);
+        edges_.push_back({from, to, link.params});
+        return {ErrorCode::Ok, ""};
     }
 
-    std::vector<PeerId> neighbors(const PeerId &p) const
+    Result<NodeIndex> addNode(const PeerId &p)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (frozen_.load(std::memory_order_relaxed))
+        {
+            return {{ErrorCode::InvalidState, "Topology is frozen"}, std::nullopt};
+        }
+        return {{ErrorCode::Ok, ""}, internLocked(p)};
+    }
+
+    Status addLink(NodeIndex from, NodeIndex to, const LinkParams &params)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (frozen_.load(std::memory_order_relaxed))
+        {
+            return {ErrorCode::InvalidState, "Topology is frozen"};
+        }
+        if (from >= peers_.size() || to >= peers_.size())
+        {
+            return {ErrorCode::NotFound, "Unknown node index"};
+        }
+        edges_.push_back({from, to, params});
+        return {ErrorCode::Ok, ""};
+    }
+
+    Status setRegion(NodeIndex idx, RegionId region)
+    {
+        std::lock_guard<std::mutex> lock(regionsMtx_);
+        if (idx >= nodeCount())
+        {
+            return {ErrorCode::NotFound, "Unknown node index"};
+        }
+        regions_[idx] = region;
+        return {ErrorCode::Ok, ""};
+    }
+
+    std::optional<RegionId> region(NodeIndex idx) const
+    {
+        std::lock_guard<std::mutex> lock(regionsMtx_);
+        auto it = regions_.find(idx);
+        if (it == regions_.end())
+            return std::nullopt;
+        return it->second;
+    }
+
+    void setRegionLatency(RegionId a, RegionId b, const LatencyModel &latency)
+    {
+        std::lock_guard<std::mutex> lock(regionsMtx_);
+        if (a > b)
+            std::swap(a, b);
+        regionLatency_[(static_cast<uint32_t>(a) << 16) | b] = latency;
+    }
+
+    std::vector<RegionLink> regionLatencies() const
+    {
+        std::lock_guard<std::mutex> lock(regionsMtx_);
+        std::vector<RegionLink> result;
+        result.reserve(regionLatency_.size());
+        for (const auto &[key, latency] : regionLatency_)
+        {
+            result.push_back({static_cast<RegionId>(key >> 16), static_cast<RegionId>(key & 0xFFFF), latency});
+        }
+        return result;
+    }
+
+    void freeze()
     {
         std::lock_guard<std::mutex> lock(mutex_);
+        if (frozen_.load(std::memory_order_relaxed))
+            return;
+
+        // Counting sort by source; keeps per-node insertion order of links
+        size_t n = peers_.size();
+        offsets_.assign(n + 1, 0);
+        for (const auto &e : edges_)
+        {
+            offsets_[e.from + 1]++;
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            offsets_[i + 1] += offsets_[i];
+        }
+        adj_.resize(edges_.size());
+        params_.resize(edges_.size());
+        std::vector<uint32_t> cursor(offsets_.begin(), offsets_.end() - 1);
+        for (auto &e : edges_)
+        {
+            uint32_t slot = cursor[e.from]++;
+            adj_[slot] = e.to;
+            params_[slot] = std::move(e.params);
+        }
+
+        edges_.clear();
+        edges_.shrink_to_fit();
+        frozen_.store(true, std::memory_order_release);
+    }
+
+    bool frozen() const
+    {
+        return frozen_.load(std::memory_order_acquire);
+    }
+
+    std::vector<PeerId> neighbors(const PeerId &p) const
+    {
         std::vector<PeerId> result;
-        for (const auto &link : links_)
+        if (frozen())
+        {
+            auto it = index_.find(peerKey(p));
+            if (it == index_.end())
+                return result;
+            for (NodeIndex n : csrNeighbors(it->second))
+            {
+                result.push_back(peers_[n]);
+            }
+            return result;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(peerKey(p));
+        if (it == index_.end())
+            return result;
+        for (const auto &e : edges_)
         {
-            if (peerIdEqual(link.from, p))
+            if (e.from == it->second)
             {
-                result.push_back(link.to);
+                result.push_back(peers_[e.to]);
             }
-            // If undirected, also check reverse
-            // if (peerIdEqual(link.to, p)) {
-            //     result.push_back(link.from);
-            // }
         }
         return result;
     }
 
+    std::span<const NodeIndex> neighbors(NodeIndex idx) const
+    {
+        if (!frozen() || idx >= peers_.size())
+            return {};
+        return csrNeighbors(idx);
+    }
+
+    std::span<const LinkParams> linkParams(NodeIndex idx) const
+    {
+        if (!frozen() || idx >= peers_.size())
+            return {};
+        return {params_.data() + offsets_[idx], params_.data() + offsets_[idx + 1]};
+    }
+
+    std::optional<NodeIndex> indexOf(const PeerId &p) const
+    {
+        std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+        if (!frozen())
+            lock.lock();
+        auto it = index_.find(peerKey(p));
+        if (it == index_.end())
+            return std::nullopt;
+        return it->second;
+    }
+
+    // By value: before freeze() a concurrent addNode may grow peers_
+    PeerId peer(NodeIndex idx) const
+    {
+        std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+        if (!frozen())
+            lock.lock();
+        return peers_.at(idx);
+    }
+
+    size_t nodeCount() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+        if (!frozen())
+            lock.lock();
+        return peers_.size();
+    }
+
+    size_t linkCount() const
+    {
+        if (frozen())
+            return adj_.size();
+        std::lock_guard<std::mutex> lock(mutex_);
+        return edges_.size();
+    }
+
 private:
+    NodeIndex internLocked(const PeerId &p)
+    {
+        auto [it, inserted] = index_.try_emplace(peerKey(p), static_cast<NodeIndex>(peers_.size()));
+        if (inserted)
+        {
+            peers_.push_back(p);
+        }
+        return it->second;
+    }
+
+    std::span<const NodeIndex> csrNeighbors(NodeIndex idx) const
+    {
+        return {adj_.data() + offsets_[idx], adj_.data() + offsets_[idx + 1]};
+    }
+
     mutable std::mutex mutex_;
-    std::vector<LinkSpec> links_;
+    std::atomic<bool> frozen_{false};
+
+    // Node interning (append-only during setup, read-only once frozen)
+    std::vector<PeerId> peers_;
+    std::unordered_map<std::string, NodeIndex> index_;
+
+    // Setup-phase edge list, released by freeze()
+    struct Edge
+    {
+        NodeIndex from;
+        NodeIndex to;
+        LinkParams params;
+    };
+    std::vector<Edge> edges_;
+
+    // CSR adjacency: neighbors of i are adj_[offsets_[i] .. offsets_[i+1]),
+    // with the matching link parameters at the same slots of params_
+    std::vector<uint32_t> offsets_;
+    std::vector<NodeIndex> adj_;
+    std::vector<LinkParams> params_;
+
+    // Region assignment is not on the lookup path, so it stays mutable
+    mutable std::mutex regionsMtx_;
+    std::unordered_map<NodeIndex, RegionId> regions_;
+    std::unordered_map<uint32_t, LatencyModel> regionLatency_;
 };
 
-Topology::Topology() : impl_(new TopologyImpl) {}
+Topology::Topology() : impl_(std::make_unique<TopologyImpl>()) {}
 Topology::~Topology() = default;
 
-void Topology::addLink(const LinkSpec &link)
+Status Topology::addLink(const LinkSpec &link)
+{
+    return impl_->addLink(link);
+}
+
+Result<NodeIndex> Topology::addNode(const PeerId &p)
+{
+    return impl_->addNode(p);
+}
+
+Status Topology::addLink(NodeIndex from, NodeIndex to, const LinkParams &params)
+{
+    return impl_->addLink(from, to, params);
+}
+
+Status Topology::setRegion(NodeIndex idx, RegionId region)
+{
+    return impl_->setRegion(idx, region);
+}
+
+std::optional<RegionId> Topology::region(NodeIndex idx) const
+{
+    return impl_->region(idx);
+}
+
+void Topology::setRegionLatency(RegionId a, RegionId b, const LatencyModel &latency)
+{
+    impl_->setRegionLatency(a, b, latency);
+}
+
+std::vector<RegionLink> Topology::regionLatencies() const
+{
+    return impl_->regionLatencies();
+}
+
+void Topology::freeze()
+{
+    impl_->freeze();
+}
+
+bool Topology::frozen() const
 {
-    impl_->addLink(link);
+    return impl_->frozen();
 }
 
 std::vector<PeerId> Topology::neighbors(const PeerId &p) const
 {
     return impl_->neighbors(p);
-}
\ No newline at end of file
+}
+
+std::span<const NodeIndex> Topology::neighbors(NodeIndex idx) const
+{
+    return impl_->neighbors(idx);
+}
+
+std::span<const LinkParams> Topology::linkParams(NodeIndex idx) const
+{
+    return impl_->linkParams(idx);
+}
+
+std::optional<NodeIndex> Topology::indexOf(const PeerId &p) const
+{
+    return impl_->indexOf(p);
+}
+
+PeerId Topology::peer(NodeIndex idx) const
+{
+    return impl_->peer(idx);
+}
+
+size_t Topology::nodeCount() const
+{
+    return impl_->nodeCount();
+}
+
+size_t Topology::linkCount() const
+{
+    return impl_->linkCount();
+}
+
+// Generators
+
+Status TopologyGenerators::randomRegular(Topology &topo, const std::string &chainId,
+                                         size_t n, size_t degree, unsigned seed)
+{
+    if (topo.frozen())
+        return {ErrorCode::InvalidState, "Topology is frozen"};
+    if (degree == 0 || degree >= n || (n * degree) % 2 != 0)
+        return {ErrorCode::InvalidState, "Random-regular graph needs 0 < degree < n and n*degree even"};
+
+    // Start from a circulant degree-regular graph ...
+    EdgeList edges;
+    edges.reserve(n * degree / 2);
+    std::unordered_set<uint64_t> present;
+    present.reserve(n * degree);
+    auto addEdge = [&](size_t a, size_t b)
+    {
+        edges.emplace_back(static_cast<NodeIndex>(a), static_cast<NodeIndex>(b));
+        present.insert(edgeKey(static_cast<NodeIndex>(a), static_cast<NodeIndex>(b)));
+    };
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 1; j <= degree / 2; ++j)
+        {
+            addEdge(i, (i + j) % n);
+        }
+        if (degree % 2 == 1 && i < n / 2)
+        {
+            addEdge(i, i + n / 2);
+        }
+    }
+
+    // ... then randomize with degree-preserving double-edge swaps
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, edges.size() - 1);
+    std::bernoulli_distribution flip(0.5);
+    size_t attempts = edges.size() * 10;
+    for (size_t t = 0; t < attempts; ++t)
+    {
+        size_t i = pick(rng);
+        size_t j = pick(rng);
+        if (i == j)
+            continue;
+        auto [a, b] = edges[i];
+        auto [c, d] = edges[j];
+        if (flip(rng))
+            std::swap(c, d);
+        // (a,b),(c,d) -> (a,d),(c,b)
+        if (a == d || c == b)
+            continue;
+        uint64_t k1 = edgeKey(a, d);
+        uint64_t k2 = edgeKey(c, b);
+        if (k1 == k2 || present.count(k1) || present.count(k2))
+            continue;
+        present.erase(edgeKey(a, b));
+        present.erase(edgeKey(c, d));
+        present.insert(k1);
+        present.insert(k2);
+        edges[i] = {a, d};
+        edges[j] = {c, b};
+    }
+
+    return materialize(topo, chainId, n, edges);
+}
+
+Status TopologyGenerators::smallWorld(Topology &topo, const std::string &chainId,
+                                      size_t n, size_t k, double beta, unsigned seed)
+{
+    if (topo.frozen())
+        return {ErrorCode::InvalidState, "Topology is frozen"};
+    if (k < 2 || k % 2 != 0 || k >= n)
+        return {ErrorCode::InvalidState, "Small-world graph needs even k with 2 <= k < n"};
+    if (beta < 0.0 || beta > 1.0)
+        return {ErrorCode::InvalidState, "Rewiring probability must be in [0, 1]"};
+
+    EdgeList edges;
+    edges.reserve(n * k / 2);
+    std::unordered_set<uint64_t> present;
+    present.reserve(n * k);
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 1; j <= k / 2; ++j)
+        {
+            NodeIndex a = static_cast<NodeIndex>(i);
+            NodeIndex b = static_cast<NodeIndex>((i + j) % n);
+            edges.emplace_back(a, b);
+            present.insert(edgeKey(a, b));
+        }
+    }
+
+    // Rewire the far endpoint of each lattice edge with probability beta
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution rewire(beta);
+    std::uniform_int_distribution<size_t> node(0, n - 1);
+    for (auto &e : edges)
+    {
+        if (!rewire(rng))
+            continue;
+        // Bounded retries so dense graphs cannot spin forever
+        for (int tries = 0; tries < 32; ++tries)
+        {
+            NodeIndex w = static_cast<NodeIndex>(node(rng));
+            if (w == e.first || present.count(edgeKey(e.first, w)))
+                continue;
+            present.erase(edgeKey(e.first, e.second));
+            present.insert(edgeKey(e.first, w));
+            e.second = w;
+            break;
+        }
+    }
+
+    return materialize(topo, chainId, n, edges);
+}
+
+Status TopologyGenerators::scaleFree(Topology &topo, const std::string &chainId,
+                                     size_t n, size_t m, unsigned seed)
+{
+    if (topo.frozen())
+        return {ErrorCode::InvalidState, "Topology is frozen"};
+    if (m == 0 || m >= n)
+        return {ErrorCode::InvalidState, "Scale-free graph needs 0 < m < n"};
+
+    EdgeList edges;
+    edges.reserve(n * m);
+    // Every edge endpoint, so uniform picks are degree-proportional
+    std::vector<NodeIndex> endpoints;
+    endpoints.reserve(2 * n * m);
+
+    // Seed with a clique on the first m + 1 nodes
+    for (size_t i = 0; i <= m; ++i)
+    {
+        for (size_t j = i + 1; j <= m; ++j)
+        {
+            edges.emplace_back(static_cast<NodeIndex>(i), static_cast<NodeIndex>(j));
+            endpoints.push_back(static_cast<NodeIndex>(i));
+            endpoints.push_back(static_cast<NodeIndex>(j));
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::vector<NodeIndex> targets;
+    targets.reserve(m);
+    for (size_t v = m + 1; v < n; ++v)
+    {
+        targets.clear();
+        std::uniform_int_distribution<size_t> pick(0, endpoints.size() - 1);
+        while (targets.size() < m)
+        {
+            NodeIndex t = endpoints[pick(rng)];
+            if (std::find(targets.begin(), targets.end(), t) == targets.end())
+            {
+                targets.push_back(t);
+            }
+        }
+        for (NodeIndex t : targets)
+        {
+            edges.emplace_back(static_cast<NodeIndex>(v), t);
+            endpoints.push_back(static_cast<NodeIndex>(v));
+            endpoints.push_back(t);
+        }
+    }
+
+    return materialize(topo, chainId, n, edges);
+}
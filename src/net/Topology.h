@@ -3,14 +3,24 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <memory>
+#include <optional>
+#include <span>
+#include <cstdint>
 #include "core/Types.h"
+#include "util/Error.h"
+#include "LinkModel.h"
 
 struct LinkSpec
 {
     PeerId from;
     PeerId to;
+    LinkParams params{};
 };
 
+// Dense integer index assigned to each peer when it is first seen.
+using NodeIndex = uint32_t;
+
 class TopologyImpl;
 
 class Topology
@@ -19,9 +29,50 @@ public:
     Topology();
     ~Topology();
 
-    void addLink(const LinkSpec &link);
+    // Setup phase: links may only be added before freeze().
+    Status addLink(const LinkSpec &link);
+    Result<NodeIndex> addNode(const PeerId &p); // existing index if already known
+    Status addLink(NodeIndex from, NodeIndex to, const LinkParams &params = {});
+
+    // Region assignment and inter-region latency (may be set at any time).
+    Status setRegion(NodeIndex idx, RegionId region);
+    std::optional<RegionId> region(NodeIndex idx) const;
+    void setRegionLatency(RegionId a, RegionId b, const LatencyModel &latency); // symmetric
+    std::vector<RegionLink> regionLatencies() const;
+
+    // Compacts all links into a CSR adjacency array. After this call the
+    // topology is immutable and every lookup below is lock-free.
+    void freeze();
+    bool frozen() const;
+
     std::vector<PeerId> neighbors(const PeerId &p) const;
+    std::span<const NodeIndex> neighbors(NodeIndex idx) const; // requires freeze()
+    std::span<const LinkParams> linkParams(NodeIndex idx) const; // parallel to neighbors(idx)
+
+    std::optional<NodeIndex> indexOf(const PeerId &p) const;
+    PeerId peer(NodeIndex idx) const; // a copy, safe before freeze()
+    size_t nodeCount() const;
+    size_t linkCount() const;
 
 private:
-    TopologyImpl *impl_;
+    std::unique_ptr<TopologyImpl> impl_;
 };
+
+// Large-scale overlay generators. Nodes are named "node-<i>" within chainId and
+// every generated edge is added in both directions. The topology is frozen on
+// success.
+namespace TopologyGenerators
+{
+    // Every node has exactly `degree` distinct neighbors (n * degree must be even).
+    Status randomRegular(Topology &topo, const std::string &chainId,
+                         size_t n, size_t degree, unsigned seed);
+
+    // Watts-Strogatz: ring lattice of `k` neighbors per node (k even), each
+    // edge rewired with probability `beta`.
+    Status smallWorld(Topology &topo, const std::string &chainId,
+                      size_t n, size_t k, double beta, unsigned seed);
+
+    // Barabasi-Albert preferential attachment, `m` edges per joining node.
+    Status scaleFree(Topology &topo, const std::string &chainId,
+                     size_t n, size_t m, unsigned seed);
+}
@@ -1,26 +1,42 @@
 // filepath: /home/niishaaant/work/blockchain-comm-sim/src/net/Transport.cpp
 #include "Transport.h"
+#include "Topology.h"
 #include "util/DetailedLogger.h"
+#include "util/Rng.h"
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
 #include <condition_variable>
 #include <unordered_map>
 #include <chrono>
-#include <random>
 #include <memory>
 #include <queue>
+#include <deque>
+#include <array>
 #include <vector>
 #include <atomic>
+#include <algorithm>
 
 using namespace std::chrono_literals;
 
 namespace
 {
     // Helper for random drop
-    bool shouldDrop(std::mt19937 &rng, double dropRate)
+    bool shouldDrop(RngStream &rng, double dropRate)
     {
-        std::uniform_real_distribution<double> dist(1.0, 1.0);
-        return dist(rng) < dropRate;
+        return dropRate > 0.0 && rng.uniform() < dropRate;
+    }
+
+    uint64_t linkKey(EndpointHandle from, EndpointHandle to)
+    {
+        return (static_cast<uint64_t>(from) << 32) | to;
+    }
+
+    uint32_t regionKey(RegionId a, RegionId b)
+    {
+        if (a > b)
+            std::swap(a, b);
+        return (static_cast<uint32_t>(a) << 16) | b;
     }
 }
 
@@ -28,26 +44,204 @@ namespace
 struct DeliveryTask
 {
     std::chrono::steady_clock::time_point deliverAt;
-    std::string to;
-    Transport::Bytes data;
+    uint64_t seq{0}; // tie-break so equal deadlines keep send order
+    EndpointHandle to{0};
+    std::shared_ptr<const Transport::Bytes> data; // shared by all multicast copies
 
     bool operator>(const DeliveryTask &other) const
     {
-        return deliverAt > other.deliverAt; // Min-heap (earliest first)
+        if (deliverAt != other.deliverAt)
+            return deliverAt > other.deliverAt; // Min-heap (earliest first)
+        return seq > other.seq;
     }
 };
 
+// Scheduling state of one directed link
+struct LinkState
+{
+    EndpointHandle from{0};
+    EndpointHandle to{0};
+    bool hasOverride{false};                        // latency set via setLinkParams
+    std::shared_ptr<const LatencySampler> latency;  // null: NetworkParams::latency
+    double bandwidthBytesPerSec{0.0};               // 0: NetworkParams default
+    double dropRate{-1.0};                          // <0: NetworkParams default
+    RngStream rng;                                  // drop and jitter draws, in send order
+    std::chrono::steady_clock::time_point nextFree{};    // transmitter busy until
+    std::chrono::steady_clock::time_point lastDeliver{}; // FIFO floor
+};
+
+// Links hashed by (from, to); senders on different links rarely share a lock
+struct LinkShard
+{
+    std::mutex mtx;
+    std::unordered_map<uint64_t, LinkState> links;
+};
+
+// One delivery executor. Every destination hashes to exactly one shard; a
+// destination with ready messages sits on `runnable` (or is claimed by the
+// worker delivering it), so its messages are never delivered concurrently.
+struct DeliveryShard
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::priority_queue<DeliveryTask, std::vector<DeliveryTask>, std::greater<DeliveryTask>> timers;
+    // Ready messages per destination; an entry exists while it is runnable or claimed
+    std::unordered_map<EndpointHandle, std::deque<DeliveryTask>> ready;
+    std::deque<EndpointHandle> runnable;
+    std::atomic<bool> idle{false}; // owner is waiting on cv with nothing to do
+};
+
+// Read-mostly address table. Every address seen (mailbox or sender) gets a
+// dense handle whose slot never moves. A slot's mailbox is an immutable entry
+// published with a release store, so readers resolve a handle with one
+// acquire load. Entries replaced or unregistered are retired and only freed
+// when the table is destroyed, which is the grace period for readers.
+class EndpointTable
+{
+public:
+    struct Entry
+    {
+        Transport::DeliverFn deliver;
+    };
+
+    ~EndpointTable()
+    {
+        for (auto &seg : segments_)
+        {
+            Segment *s = seg.load(std::memory_order_relaxed);
+            if (!s)
+                continue;
+            for (auto &slot : s->slots)
+            {
+                delete slot.entry.load(std::memory_order_relaxed);
+            }
+            delete s;
+        }
+        for (const Entry *e : retired_)
+        {
+            delete e;
+        }
+    }
+
+    // Existing handle for address, or a new one (nullopt when the table is full)
+    std::optional<EndpointHandle> intern(const std::string &address)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(namesMtx_);
+            auto it = names_.find(address);
+            if (it != names_.end())
+                return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(namesMtx_);
+        auto it = names_.find(address);
+        if (it != names_.end())
+            return it->second;
+
+        EndpointHandle h = static_cast<EndpointHandle>(names_.size());
+        size_t seg = h / kSegmentSize;
+        if (seg >= kMaxSegments)
+            return std::nullopt;
+        Segment *s = segments_[seg].load(std::memory_order_relaxed);
+        if (!s)
+        {
+            s = new Segment();
+            segments_[seg].store(s, std::memory_order_release);
+        }
+        s->slots[h % kSegmentSize].name = address;
+        names_.emplace(address, h);
+        return h;
+    }
+
+    std::optional<EndpointHandle> find(const std::string &address) const
+    {
+        std::shared_lock<std::shared_mutex> lock(namesMtx_);
+        auto it = names_.find(address);
+        if (it == names_.end())
+            return std::nullopt;
+        return it->second;
+    }
+
+    // Lock-free: current mailbox of h, or nullptr
+    const Entry *entry(EndpointHandle h) const
+    {
+        const Slot *slot = slotFor(h);
+        return slot ? slot->entry.load(std::memory_order_acquire) : nullptr;
+    }
+
+    const std::string &name(EndpointHandle h) const
+    {
+        static const std::string unknown = "unknown";
+        const Slot *slot = slotFor(h);
+        return slot ? slot->name : unknown;
+    }
+
+    bool install(EndpointHandle h, Transport::DeliverFn deliver)
+    {
+        std::lock_guard<std::mutex> lock(writeMtx_);
+        Slot *slot = slotFor(h);
+        if (slot->entry.load(std::memory_order_relaxed))
+            return false;
+        slot->entry.store(new Entry{std::move(deliver)}, std::memory_order_release);
+        return true;
+    }
+
+    bool remove(EndpointHandle h)
+    {
+        std::lock_guard<std::mutex> lock(writeMtx_);
+        Slot *slot = slotFor(h);
+        const Entry *old = slot ? slot->entry.exchange(nullptr, std::memory_order_acq_rel) : nullptr;
+        if (!old)
+            return false;
+        retired_.push_back(old);
+        return true;
+    }
+
+private:
+    static constexpr size_t kSegmentSize = 1024;
+    static constexpr size_t kMaxSegments = 1024; // ~1M addresses
+
+    struct Slot
+    {
+        std::string name; // written once, before the handle is handed out
+        std::atomic<const Entry *> entry{nullptr};
+    };
+    struct Segment
+    {
+        std::array<Slot, kSegmentSize> slots;
+    };
+
+    Slot *slotFor(EndpointHandle h) const
+    {
+        size_t seg = h / kSegmentSize;
+        if (seg >= kMaxSegments)
+            return nullptr;
+        Segment *s = segments_[seg].load(std::memory_order_acquire);
+        return s ? &s->slots[h % kSegmentSize] : nullptr;
+    }
+
+    std::array<std::atomic<Segment *>, kMaxSegments> segments_{};
+    std::unordered_map<std::string, EndpointHandle> names_;
+    mutable std::shared_mutex namesMtx_;
+    std::vector<const Entry *> retired_;
+    std::mutex writeMtx_;
+};
+
 class TransportImpl
 {
 public:
     TransportImpl(unsigned seed, NetworkParams params, DetailedLogger *detailedLogger)
         : params_(params), rng_(seed), detailedLogger_(detailedLogger), running_(true)
     {
-        // Create thread pool (4 workers)
-        for (size_t i = 0; i < 4; ++i)
+        // One shard per worker; deliveries are routed by destination handle
+        size_t workerCount = std::max<size_t>(1, params.workerThreads);
+        for (size_t i = 0; i < workerCount; ++i)
+        {
+            shards_.push_back(std::make_unique<DeliveryShard>());
+        }
+        for (size_t i = 0; i < workerCount; ++i)
         {
-            workers_.emplace_back([this]()
-                                  { workerLoop(); });
+            workers_.emplace_back([this, i]()
+                                  { workerLoop(i); });
         }
     }
 
@@ -56,36 +250,76 @@ public:
         shutdown();
     }
 
-    Status registerEndpoint(const std::string &address, Transport::DeliverFn deliver)
+    Result<EndpointHandle> registerEndpoint(const std::string &address, Transport::DeliverFn deliver)
     {
-        std::lock_guard<std::mutex> lock(endpointsMtx_);
-        if (endpoints_.count(address))
+        auto h = endpoints_.intern(address);
+        if (!h)
         {
-            return {ErrorCode::InvalidState, "Endpoint already registered"};
+            return {{ErrorCode::InvalidState, "Endpoint table full"}, std::nullopt};
         }
-        endpoints_[address] = {deliver};
-        return {ErrorCode::Ok, ""};
+        if (!endpoints_.install(*h, std::move(deliver)))
+        {
+            return {{ErrorCode::InvalidState, "Endpoint already registered"}, std::nullopt};
+        }
+        return {{ErrorCode::Ok, ""}, *h};
+    }
+
+    Result<EndpointHandle> resolve(const std::string &address)
+    {
+        auto h = endpoints_.intern(address);
+        if (!h)
+        {
+            return {{ErrorCode::InvalidState, "Endpoint table full"}, std::nullopt};
+        }
+        return {{ErrorCode::Ok, ""}, *h};
     }
 
     Status send(const std::string &from, const std::string &to, const Transport::Bytes &data)
     {
+        auto dst = endpoints_.find(to);
+        if (!dst)
         {
-            std::lock_guard<std::mutex> lock(endpointsMtx_);
-            if (!endpoints_.count(to))
+            return {ErrorCode::NotFound, "Destination endpoint not found"};
+        }
+        auto src = resolve(from);
+        if (!src.status.ok())
+        {
+            return src.status;
+        }
+        return send(*src.value, *dst, data);
+    }
+
+    Status send(EndpointHandle from, EndpointHandle to, const Transport::Bytes &data)
+    {
+        if (!endpoints_.entry(to))
+        {
+            return {ErrorCode::NotFound, "Destination endpoint not found"};
+        }
+
+        // Simulate drop, then queue behind earlier sends on the same link
+        bool dropped = false;
+        std::chrono::steady_clock::time_point deliverAt;
+        uint64_t seq = 0;
+        {
+            LinkShard &links = linkShardFor(linkKey(from, to));
+            std::lock_guard<std::mutex> lock(links.mtx);
+            LinkState &link = linkLocked(links, from, to);
+            dropped = shouldDrop(link.rng, link.dropRate >= 0.0 ? link.dropRate : params_.dropRate);
+            if (!dropped)
             {
-                return {ErrorCode::NotFound, "Destination endpoint not found"};
+                deliverAt = scheduleLocked(link, data.size());
+                seq = nextTaskSeq_++;
             }
         }
 
-        // Simulate drop
-        if (shouldDrop(rng_, params_.dropRate))
+        if (dropped)
         {
             // Log network drop
             if (detailedLogger_)
             {
                 detailedLogger_->logNetworkDrop(
-                    from,
-                    to,
+                    endpoints_.name(from),
+                    endpoints_.name(to),
                     "unknown", // message type - could be inferred from data
                     data.size(),
                     "random_drop");
@@ -95,20 +329,120 @@ public:
 
         // Schedule task for delayed delivery
         DeliveryTask task;
-        task.deliverAt = std::chrono::steady_clock::now() + params_.latency;
+        task.deliverAt = deliverAt;
+        task.seq = seq;
         task.to = to;
-        task.data = data;
+        task.data = std::make_shared<const Transport::Bytes>(data);
 
+        DeliveryShard &shard = shardFor(to);
+        outstanding_++;
         {
-            std::lock_guard<std::mutex> lock(tasksMtx_);
-            tasks_.push(task);
-            pendingCount_++;
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            shard.timers.push(std::move(task));
         }
-        tasksCV_.notify_one();
+        shard.cv.notify_one();
 
         return {ErrorCode::Ok, ""};
     }
 
+    Status multicast(const std::string &from, const std::vector<std::string> &to, const Transport::Bytes &data)
+    {
+        auto src = resolve(from);
+        if (!src.status.ok())
+        {
+            return src.status;
+        }
+        // Unknown addresses are looked up, not interned, and count as not found
+        std::vector<EndpointHandle> handles;
+        handles.reserve(to.size());
+        size_t unknown = 0;
+        for (const auto &addr : to)
+        {
+            auto h = endpoints_.find(addr);
+            if (!h)
+            {
+                unknown++;
+                continue;
+            }
+            handles.push_back(*h);
+        }
+        return multicast(*src.value, handles, data, unknown);
+    }
+
+    // `unknown` destinations were already rejected by the caller
+    Status multicast(EndpointHandle from, const std::vector<EndpointHandle> &to, const Transport::Bytes &data,
+                     size_t unknown = 0)
+    {
+        auto payload = std::make_shared<const Transport::Bytes>(data);
+
+        // Per-destination drop decision and delivery time, each under its link's shard
+        std::vector<DeliveryTask> tasks;
+        tasks.reserve(to.size());
+        std::vector<EndpointHandle> dropped;
+        size_t missing = unknown;
+        for (EndpointHandle dst : to)
+        {
+            if (!endpoints_.entry(dst))
+            {
+                missing++;
+                continue;
+            }
+            LinkShard &links = linkShardFor(linkKey(from, dst));
+            std::lock_guard<std::mutex> lock(links.mtx);
+            LinkState &link = linkLocked(links, from, dst);
+            if (shouldDrop(link.rng, link.dropRate >= 0.0 ? link.dropRate : params_.dropRate))
+            {
+                dropped.push_back(dst);
+                continue;
+            }
+            DeliveryTask task;
+            task.deliverAt = scheduleLocked(link, data.size());
+            task.seq = nextTaskSeq_++;
+            task.to = dst;
+            task.data = payload;
+            tasks.push_back(std::move(task));
+        }
+
+        if (detailedLogger_)
+        {
+            for (EndpointHandle dst : dropped)
+            {
+                detailedLogger_->logNetworkDrop(endpoints_.name(from), endpoints_.name(dst), "unknown", data.size(), "random_drop");
+            }
+        }
+
+        // Push grouped by shard so each shard lock is taken once
+        outstanding_ += tasks.size();
+        std::vector<std::vector<DeliveryTask>> byShard(shards_.size());
+        for (auto &task : tasks)
+        {
+            byShard[shardIndex(task.to)].push_back(std::move(task));
+        }
+        for (size_t s = 0; s < byShard.size(); ++s)
+        {
+            if (byShard[s].empty())
+                continue;
+            DeliveryShard &shard = *shards_[s];
+            {
+                std::lock_guard<std::mutex> lock(shard.mtx);
+                for (auto &task : byShard[s])
+                {
+                    shard.timers.push(std::move(task));
+                }
+            }
+            shard.cv.notify_one();
+        }
+
+        if (dropped.empty() && missing == 0)
+        {
+            return {ErrorCode::Ok, ""};
+        }
+        std::string summary = std::to_string(dropped.size()) + " dropped, " +
+                              std::to_string(missing) + " not found of " +
+                              std::to_string(to.size() + unknown) + " destinations";
+        return {missing > 0 ? ErrorCode::NotFound : ErrorCode::NetworkDrop, summary};
+    }
+
     void setParams(NetworkParams p)
     {
         // This is not fully thread-safe if called concurrently with send,
@@ -116,10 +450,86 @@ public:
         params_ = p;
     }
 
+    Status setLinkParams(const std::string &from, const std::string &to, const LinkParams &p)
+    {
+        auto src = resolve(from);
+        auto dst = resolve(to);
+        if (!src.status.ok() || !dst.status.ok())
+        {
+            return {ErrorCode::InvalidState, "Endpoint table full"};
+        }
+        LinkShard &links = linkShardFor(linkKey(*src.value, *dst.value));
+        std::lock_guard<std::mutex> lock(links.mtx);
+        LinkState &link = linkLocked(links, *src.value, *dst.value);
+        link.hasOverride = p.latency.has_value();
+        link.bandwidthBytesPerSec = p.bandwidthBytesPerSec;
+        link.dropRate = p.dropRate;
+        if (link.hasOverride)
+        {
+            link.latency = std::make_shared<const LatencySampler>(*p.latency, samplerSeed("link-latency", link.rng.key()));
+        }
+        else
+        {
+            std::shared_lock<std::shared_mutex> regionLock(regionMtx_);
+            resolveLatencyLocked(link);
+        }
+        return {ErrorCode::Ok, ""};
+    }
+
+    Status setRegion(const std::string &address, RegionId region)
+    {
+        auto h = resolve(address);
+        if (!h.status.ok())
+        {
+            return h.status;
+        }
+        // Only the links touching this endpoint, so a whole topology costs O(E).
+        // A link created after the copy already sees the new region.
+        std::vector<uint64_t> touching;
+        {
+            std::unique_lock<std::shared_mutex> lock(regionMtx_);
+            regions_[*h.value] = region;
+            auto it = endpointLinks_.find(*h.value);
+            if (it != endpointLinks_.end())
+                touching = it->second;
+        }
+        for (uint64_t key : touching)
+        {
+            LinkShard &links = linkShardFor(key);
+            std::lock_guard<std::mutex> lock(links.mtx);
+            LinkState &link = links.links.at(key);
+            if (!link.hasOverride)
+            {
+                std::shared_lock<std::shared_mutex> regionLock(regionMtx_);
+                resolveLatencyLocked(link);
+            }
+        }
+        return {ErrorCode::Ok, ""};
+    }
+
+    void setRegionLatency(RegionId a, RegionId b, const LatencyModel &latency)
+    {
+        uint32_t key = regionKey(a, b);
+        {
+            std::unique_lock<std::shared_mutex> lock(regionMtx_);
+            regionLatency_[key] = std::make_shared<const LatencySampler>(latency, samplerSeed("region-latency", key));
+        }
+        for (LinkShard &links : linkShards_)
+        {
+            std::lock_guard<std::mutex> lock(links.mtx);
+            std::shared_lock<std::shared_mutex> regionLock(regionMtx_);
+            for (auto &[k, link] : links.links)
+            {
+                if (!link.hasOverride)
+                    resolveLatencyLocked(link);
+            }
+        }
+    }
+
     Status unregisterEndpoint(const std::string &address)
     {
-        std::lock_guard<std::mutex> lock(endpointsMtx_);
-        if (endpoints_.erase(address) == 0)
+        auto h = endpoints_.find(address);
+        if (!h || !endpoints_.remove(*h))
         {
             return {ErrorCode::NotFound, "Endpoint not registered"};
         }
@@ -128,9 +538,9 @@ public:
 
     void waitForPendingDeliveries()
     {
-        std::unique_lock<std::mutex> lock(tasksMtx_);
+        std::unique_lock<std::mutex> lock(drainMtx_);
         drainCV_.wait(lock, [this]()
-                      { return pendingCount_ == 0 && inflightCount_ == 0; });
+                      { return outstanding_ == 0; });
     }
 
     void shutdown()
@@ -138,7 +548,11 @@ public:
         if (!running_.exchange(false))
             return;
 
-        tasksCV_.notify_all();
+        for (auto &shard : shards_)
+        {
+            std::lock_guard<std::mutex> lock(shard->mtx);
+            shard->cv.notify_all();
+        }
 
         for (auto &worker : workers_)
         {
@@ -150,102 +564,281 @@ public:
     }
 
 private:
-    void workerLoop()
+    LinkShard &linkShardFor(uint64_t key)
     {
-        while (running_)
+        return linkShards_[splitmix64(key) % kLinkShards];
+    }
+
+    // Find or create the state for from -> to (caller holds links.mtx)
+    LinkState &linkLocked(LinkShard &links, EndpointHandle from, EndpointHandle to)
+    {
+        uint64_t key = linkKey(from, to);
+        auto [it, inserted] = links.links.try_emplace(key);
+        if (inserted)
         {
-            DeliveryTask task;
-            bool hasTask = false;
+            it->second.from = from;
+            it->second.to = to;
+            // Keyed by address names, so the stream does not depend on handle order
+            it->second.rng = rng_.stream("link", stableHash(endpoints_.name(from) + "->" + endpoints_.name(to)));
+            // Registered and resolved in one step, so setRegion never misses it
+            std::unique_lock<std::shared_mutex> regionLock(regionMtx_);
+            endpointLinks_[from].push_back(key);
+            if (to != from)
+                endpointLinks_[to].push_back(key);
+            resolveLatencyLocked(it->second);
+        }
+        return it->second;
+    }
+
+    // Pick the region-pair sampler for a link without its own latency model
+    // (caller holds regionMtx_)
+    void resolveLatencyLocked(LinkState &link)
+    {
+        link.latency.reset();
+        auto rf = regions_.find(link.from);
+        auto rt = regions_.find(link.to);
+        if (rf == regions_.end() || rt == regions_.end())
+            return;
+        auto it = regionLatency_.find(regionKey(rf->second, rt->second));
+        if (it != regionLatency_.end())
+            link.latency = it->second;
+    }
+
+    // Serialization at the link's bandwidth, FIFO behind earlier sends, then propagation
+    std::chrono::steady_clock::time_point scheduleLocked(LinkState &link, size_t bytes)
+    {
+        using namespace std::chrono;
+        auto now = steady_clock::now();
+        auto txEnd = std::max(now, link.nextFree);
+        double bw = link.bandwidthBytesPerSec > 0.0 ? link.bandwidthBytesPerSec : params_.bandwidthBytesPerSec;
+        if (bw > 0.0)
+        {
+            txEnd += duration_cast<steady_clock::duration>(duration<double>(static_cast<double>(bytes) / bw));
+            link.nextFree = txEnd;
+        }
+        else
+        {
+            txEnd = now;
+        }
+
+        steady_clock::duration propagation = params_.latency;
+        if (link.latency)
+        {
+            propagation = link.latency->sample(link.rng.next());
+        }
+
+        auto deliverAt = std::max(txEnd + propagation, link.lastDeliver);
+        link.lastDeliver = deliverAt;
+        return deliverAt;
+    }
+
+    unsigned samplerSeed(std::string_view domain, uint64_t key) const
+    {
+        return static_cast<unsigned>(rng_.stream(domain, key).at(0));
+    }
+
+    size_t shardIndex(EndpointHandle to) const
+    {
+        return to % shards_.size();
+    }
 
+    DeliveryShard &shardFor(EndpointHandle to)
+    {
+        return *shards_[shardIndex(to)];
+    }
+
+    // Move due timers onto their destination's ready queue (caller holds shard.mtx)
+    static void promoteDueLocked(DeliveryShard &shard, std::chrono::steady_clock::time_point now)
+    {
+        while (!shard.timers.empty() && shard.timers.top().deliverAt <= now)
+        {
+            // Moving out of top() leaves deliverAt/seq intact, so pop() stays valid
+            DeliveryTask task = std::move(const_cast<DeliveryTask &>(shard.timers.top()));
+            shard.timers.pop();
+            auto [it, inserted] = shard.ready.try_emplace(task.to);
+            if (inserted)
             {
-                std::unique_lock<std::mutex> lock(tasksMtx_);
+                shard.runnable.push_back(task.to);
+            }
+            it->second.push_back(std::move(task));
+        }
+    }
 
-                // Wait for a task or shutdown
-                tasksCV_.wait(lock, [this]()
-                              { return !running_ || !tasks_.empty(); });
+    // Claim one runnable destination of `shard` and deliver a batch of its
+    // messages in order. Stealers take whole destinations from the back of
+    // another shard's run queue and never block on its lock.
+    bool drainShard(DeliveryShard &shard, bool steal)
+    {
+        EndpointHandle dest;
+        std::vector<DeliveryTask> batch;
+        bool backlogged = false;
+        {
+            std::unique_lock<std::mutex> lock(shard.mtx, std::defer_lock);
+            if (steal)
+            {
+                if (!lock.try_lock())
+                    return false;
+            }
+            else
+            {
+                lock.lock();
+            }
 
-                if (!running_ && tasks_.empty())
-                    break;
+            promoteDueLocked(shard, std::chrono::steady_clock::now());
+            if (shard.runnable.empty())
+                return false;
 
-                if (!tasks_.empty())
-                {
-                    task = tasks_.top();
-
-                    // Check if task is ready
-                    auto now = std::chrono::steady_clock::now();
-                    if (task.deliverAt <= now)
-                    {
-                        tasks_.pop();
-                        hasTask = true;
-                    }
-                    else
-                    {
-                        // Task not ready, wait until it is
-                        auto wait_duration = task.deliverAt - now;
-                        tasksCV_.wait_for(lock, wait_duration);
-                        continue;
-                    }
-                }
+            if (steal)
+            {
+                dest = shard.runnable.back();
+                shard.runnable.pop_back();
             }
+            else
+            {
+                dest = shard.runnable.front();
+                shard.runnable.pop_front();
+            }
+            backlogged = shard.runnable.size() >= kStealThreshold;
 
-            if (hasTask)
+            auto &queue = shard.ready[dest];
+            size_t n = std::min(queue.size(), kMaxBatch);
+            batch.reserve(n);
+            for (size_t i = 0; i < n; ++i)
             {
-                // Update counters: task removed from queue, now in-flight
-                {
-                    std::lock_guard<std::mutex> lock(tasksMtx_);
-                    pendingCount_--;
-                    inflightCount_++;
-                }
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
 
-                // Execute delivery outside the lock
-                Transport::DeliverFn deliver;
-                {
-                    std::lock_guard<std::mutex> lock(endpointsMtx_);
-                    auto it = endpoints_.find(task.to);
-                    if (it != endpoints_.end())
-                    {
-                        deliver = it->second.deliver;
-                    }
-                }
+        // Outside the lock: waking a worker takes its shard's lock
+        if (backlogged)
+        {
+            signalStealers();
+        }
+        deliverBatch(dest, batch);
 
-                if (deliver)
-                {
-                    deliver(task.data);
-                }
+        // Release the destination, or requeue it if more arrived meanwhile
+        {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            auto it = shard.ready.find(dest);
+            if (it->second.empty())
+            {
+                shard.ready.erase(it);
+            }
+            else
+            {
+                shard.runnable.push_back(dest);
+            }
+        }
+        return true;
+    }
 
-                // Delivery complete, update counter and notify waiters
-                {
-                    std::lock_guard<std::mutex> lock(tasksMtx_);
-                    inflightCount_--;
-                    if (pendingCount_ == 0 && inflightCount_ == 0)
-                    {
-                        drainCV_.notify_all();
-                    }
-                }
+    void deliverBatch(EndpointHandle to, const std::vector<DeliveryTask> &batch)
+    {
+        // Entries are immutable and outlive readers, so no copy of the callback
+        if (const EndpointTable::Entry *entry = endpoints_.entry(to))
+        {
+            for (const auto &task : batch)
+            {
+                entry->deliver(*task.data);
+            }
+        }
+
+        // Delivery complete, update counter and notify waiters
+        if (outstanding_.fetch_sub(batch.size()) == batch.size())
+        {
+            std::lock_guard<std::mutex> lock(drainMtx_);
+            drainCV_.notify_all();
+        }
+    }
+
+    // A shard has more runnable destinations than its worker is delivering:
+    // wake the idle workers so they steal them
+    void signalStealers()
+    {
+        stealEpoch_.fetch_add(1);
+        for (auto &shard : shards_)
+        {
+            if (shard->idle.load())
+            {
+                std::lock_guard<std::mutex> lock(shard->mtx);
+                shard->cv.notify_one();
             }
         }
     }
 
+    void workerLoop(size_t self)
+    {
+        DeliveryShard &own = *shards_[self];
+        while (running_)
+        {
+            if (drainShard(own, false))
+                continue;
+
+            // Own shard idle: help with other destinations
+            uint64_t epoch = stealEpoch_.load();
+            bool stole = false;
+            for (size_t k = 1; k < shards_.size() && !stole; ++k)
+            {
+                stole = drainShard(*shards_[(self + k) % shards_.size()], true);
+            }
+            if (stole)
+                continue;
+
+            std::unique_lock<std::mutex> lock(own.mtx);
+            if (!running_)
+                break;
+            auto now = std::chrono::steady_clock::now();
+            if (!own.runnable.empty() || (!own.timers.empty() && own.timers.top().deliverAt <= now))
+                continue;
+
+            // Sleep until the next local deadline or a steal signal. Publishing
+            // `idle` before rechecking the epoch pairs with signalStealers(),
+            // so a signal sent since the scan above is never missed.
+            own.idle.store(true);
+            if (stealEpoch_.load() != epoch)
+            {
+                own.idle.store(false);
+                continue;
+            }
+            auto wake = now + std::chrono::hours(1);
+            if (!own.timers.empty())
+            {
+                wake = std::min(wake, own.timers.top().deliverAt);
+            }
+            own.cv.wait_until(lock, wake);
+            own.idle.store(false);
+        }
+    }
+
+    static constexpr size_t kMaxBatch = 32;
+    static constexpr size_t kStealThreshold = 1; // destinations left waiting before stealers are woken
+
     NetworkParams params_;
-    std::mt19937 rng_;
+    RngService rng_;
     DetailedLogger *detailedLogger_;
 
     // Endpoints
-    std::unordered_map<std::string, Transport::Endpoint> endpoints_;
-    std::mutex endpointsMtx_;
+    EndpointTable endpoints_;
 
-    // Thread pool
+    // Link model. A link's shard lock is taken before regionMtx_.
+    static constexpr size_t kLinkShards = 64;
+    std::array<LinkShard, kLinkShards> linkShards_;
+    std::shared_mutex regionMtx_; // guards the three maps below
+    std::unordered_map<EndpointHandle, std::vector<uint64_t>> endpointLinks_; // link keys by either end
+    std::unordered_map<EndpointHandle, RegionId> regions_;
+    std::unordered_map<uint32_t, std::shared_ptr<const LatencySampler>> regionLatency_;
+
+    // Thread pool, one delivery shard per worker
     std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<DeliveryShard>> shards_;
     std::atomic<bool> running_;
+    std::atomic<uint64_t> stealEpoch_{0}; // bumped by signalStealers()
+    std::atomic<uint64_t> nextTaskSeq_{0}; // taken under the link's lock, so increasing per link
 
-    // Task queue (priority queue for earliest delivery first)
-    std::priority_queue<DeliveryTask, std::vector<DeliveryTask>, std::greater<DeliveryTask>> tasks_;
-    std::mutex tasksMtx_;
-    std::condition_variable tasksCV_;
-
-    // Pending task tracking for drain
-    std::atomic<size_t> pendingCount_{0};
-    std::atomic<size_t> inflightCount_{0}; // Tasks currently being delivered
+    // Tasks scheduled but not yet delivered, for drain
+    std::atomic<size_t> outstanding_{0};
+    std::mutex drainMtx_;
     std::condition_variable drainCV_;
 };
 
@@ -256,9 +849,14 @@ Transport::Transport(unsigned seed, NetworkParams params, DetailedLogger *detail
 
 Transport::~Transport() = default;
 
-Status Transport::registerEndpoint(const std::string &address, DeliverFn deliver)
+Result<EndpointHandle> Transport::registerEndpoint(const std::string &address, DeliverFn deliver)
+{
+    return impl_->registerEndpoint(address, std::move(deliver));
+}
+
+Result<EndpointHandle> Transport::resolve(const std::string &address)
 {
-    return impl_->registerEndpoint(address, deliver);
+    return impl_->resolve(address);
 }
 
 Status Transport::send(const std::string &from, const std::string &to, const Bytes &data)
@@ -266,11 +864,76 @@ Status Transport::send(const std::string &from, const std::string &to, const Byt
     return impl_->send(from, to, data);
 }
 
+Status Transport::send(EndpointHandle from, EndpointHandle to, const Bytes &data)
+{
+    return impl_->send(from, to, data);
+}
+
+Status Transport::multicast(const std::string &from, const std::vector<std::string> &to, const Bytes &data)
+{
+    return impl_->multicast(from, to, data);
+}
+
+Status Transport::multicast(EndpointHandle from, const std::vector<EndpointHandle> &to, const Bytes &data)
+{
+    return impl_->multicast(from, to, data);
+}
+
 void Transport::setParams(NetworkParams p)
 {
     impl_->setParams(p);
 }
 
+Status Transport::setLinkParams(const std::string &from, const std::string &to, const LinkParams &p)
+{
+    return impl_->setLinkParams(from, to, p);
+}
+
+Status Transport::setRegion(const std::string &address, RegionId region)
+{
+    return impl_->setRegion(address, region);
+}
+
+void Transport::setRegionLatency(RegionId a, RegionId b, const LatencyModel &latency)
+{
+    impl_->setRegionLatency(a, b, latency);
+}
+
+Status Transport::applyTopology(const Topology &topo)
+{
+    if (!topo.frozen())
+    {
+        return {ErrorCode::InvalidState, "Topology must be frozen before it is applied"};
+    }
+    for (const auto &rl : topo.regionLatencies())
+    {
+        impl_->setRegionLatency(rl.a, rl.b, rl.latency);
+    }
+    for (NodeIndex i = 0; i < topo.nodeCount(); ++i)
+    {
+        std::string from = toAddress(topo.peer(i));
+        if (auto region = topo.region(i))
+        {
+            Status s = impl_->setRegion(from, *region);
+            if (!s.ok())
+                return s;
+        }
+        auto nbrs = topo.neighbors(i);
+        auto params = topo.linkParams(i);
+        for (size_t k = 0; k < nbrs.size(); ++k)
+        {
+            const LinkParams &lp = params[k];
+            if (lp.latency || lp.bandwidthBytesPerSec > 0.0 || lp.dropRate >= 0.0)
+            {
+                Status s = impl_->setLinkParams(from, toAddress(topo.peer(nbrs[k])), lp);
+                if (!s.ok())
+                    return s;
+            }
+        }
+    }
+    return {ErrorCode::Ok, ""};
+}
+
 Status Transport::unregisterEndpoint(const std::string &address)
 {
     return impl_->unregisterEndpoint(address);
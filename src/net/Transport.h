@@ -6,37 +6,64 @@
 #include <chrono>
 #include <random>
 #include <memory>
+#include <vector>
+#include <cstdint>
 #include "util/Error.h"
+#include "LinkModel.h"
 
 struct NetworkParams
 {
     std::chrono::milliseconds latency{50};
     double dropRate{0.01};
+    double bandwidthBytesPerSec{0.0}; // default per-link cap, 0 = unlimited
+    size_t workerThreads{4};          // delivery executors, fixed at construction
 };
 
+// Compact id of a transport address, stable for the transport's lifetime.
+using EndpointHandle = uint32_t;
+
 class TransportImpl;
 class DetailedLogger;
+class Topology;
 
 class Transport
 {
 public:
     using Bytes = std::string;
     using DeliverFn = std::function<void(const Bytes &)>;
-    struct Endpoint
-    {
-        DeliverFn deliver;
-    };
     Transport(unsigned seed, NetworkParams params, DetailedLogger* detailedLogger = nullptr);
     ~Transport();
 
-    // Register a mailbox identified by peer address; returns Status.
-    Status registerEndpoint(const std::string &address, DeliverFn deliver);
+    // Register a mailbox identified by peer address; returns its handle.
+    Result<EndpointHandle> registerEndpoint(const std::string &address, DeliverFn deliver);
+
+    // Resolve an address (mailbox or sender-only) to its handle once, so hot
+    // paths can use the handle overloads and skip string hashing and locks.
+    Result<EndpointHandle> resolve(const std::string &address);
 
     // Asynchronous send with simulated latency/drops.
     Status send(const std::string &from, const std::string &to, const Bytes &data);
+    Status send(EndpointHandle from, EndpointHandle to, const Bytes &data);
+
+    // Send one payload to many endpoints. The bytes are copied once and shared;
+    // each destination still gets its own link latency and drop decision.
+    // Returns Ok only if every destination was scheduled; unknown addresses are
+    // reported as NotFound and never added to the endpoint table.
+    Status multicast(const std::string &from, const std::vector<std::string> &to, const Bytes &data);
+    Status multicast(EndpointHandle from, const std::vector<EndpointHandle> &to, const Bytes &data);
 
     void setParams(NetworkParams p);
 
+    // Link model. Latency resolves per-link override -> region matrix ->
+    // NetworkParams; each directed link serializes at its bandwidth cap and
+    // delivers in FIFO order.
+    Status setLinkParams(const std::string &from, const std::string &to, const LinkParams &p);
+    Status setRegion(const std::string &address, RegionId region);
+    void setRegionLatency(RegionId a, RegionId b, const LatencyModel &latency); // symmetric
+
+    // Import link params, regions and the region matrix of a frozen topology.
+    Status applyTopology(const Topology &topo);
+
     // Unregister a mailbox
     Status unregisterEndpoint(const std::string &address);
 
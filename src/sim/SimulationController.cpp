@@ -10,9 +10,17 @@ SimulationController::SimulationController(const std::vector<ChainConfig>& chain
       rootLog_("sim"),
       metrics_(),
       detailedLogger_(),
-      netParams_{simCfg.defaultLinkLatency, simCfg.packetDropRate},
+      rng_(simCfg.rngSeed),
+      netParams_{simCfg.defaultLinkLatency, simCfg.packetDropRate, simCfg.linkBandwidthBytesPerSec, simCfg.transportWorkers},
       transport_(simCfg.rngSeed, netParams_, &detailedLogger_),
-      trafficRng_(simCfg.rngSeed + 1)  // Different seed for traffic
+      relayerCoordinator_(CoordinatorParams{
+          simCfg.enableRelayerCompetition ? RelayerAssignment::Competition : simCfg.relayerAssignment,
+          simCfg.relayerLeaseTtl}),
+      relayerPool_([this](size_t index) { return makeRelayer(index); },
+                   RelayerPoolParams{simCfg.relayerMin, simCfg.relayerMax, simCfg.enableElasticRelayers,
+                                     simCfg.relayLatencySlo},
+                   rootLog_, metrics_),
+      trafficRng_(rng_.stream("traffic"))
 {
     for (const auto& chainCfg : chains) {
         chainCfgs_.push_back(chainCfg);
@@ -37,6 +45,14 @@ Status SimulationController::init() {
     // Create chains and nodes
     for (const auto& chainCfg : chainCfgs_) {
         auto chain = std::make_unique<Blockchain>(chainCfg.chainId, bus_, rootLog_, metrics_, &detailedLogger_);
+        chain->setDefaultPacketTimeout(simCfg_.ibcPacketTimeout);
+        chain->setAckAggregation(simCfg_.ackBatchMaxPackets, simCfg_.ackBatchMaxDelay);
+        SendWindowParams window;
+        window.enabled = simCfg_.enableSendWindow;
+        window.initialWindow = simCfg_.sendWindowInitial;
+        window.maxWindow = simCfg_.sendWindowMax;
+        chain->setSendWindow(window);
+        chain->setProofVerification(simCfg_.verifyPacketProofs);
         std::string chain_mailbox_address; // To store the address for the relayers
         for (size_t i = 0; i < chainCfg.nodeCount; ++i) {
             std::string nodeId = "node-" + std::to_string(i);
@@ -49,26 +65,37 @@ Status SimulationController::init() {
         }
         chains_.push_back(std::move(chain));
 
-        // Connect this chain's mailbox to all relayers
+        // Every relayer the pool creates connects to this chain's mailbox
         if (!chain_mailbox_address.empty()) {
-            // Store for later relayer connection
-            for (size_t r = 0; r < simCfg_.relayerCount; ++r) {
-                if (r >= relayers_.size()) {
-                    // Create relayer if not yet created
-                    std::string relayerId = "relayer-" + std::to_string(r);
-                    relayers_.push_back(
-                        std::make_unique<Relayer>(transport_, bus_, relayerId, rootLog_, metrics_, &detailedLogger_)
-                    );
-                }
-                relayers_[r]->connectChainMailbox(chainCfg.chainId, chain_mailbox_address);
-            }
+            chainMailboxes_.emplace_back(chainCfg.chainId, chain_mailbox_address);
         }
     }
 
-    rootLog_.info("Simulation initialized with " + std::to_string(relayers_.size()) + " relayers.");
+    rootLog_.info("Simulation initialized with " + std::to_string(simCfg_.relayerCount) + " relayers.");
     return {ErrorCode::Ok, ""};
 }
 
+std::unique_ptr<Relayer> SimulationController::makeRelayer(size_t index) {
+    std::string relayerId = "relayer-" + std::to_string(index);
+    auto relayer = std::make_unique<Relayer>(transport_, bus_, relayerId, rootLog_, metrics_, &detailedLogger_,
+                                             rng_.stream("relayer", index));
+    relayer->setBatching({simCfg_.relayBatchMaxPackets, simCfg_.relayBatchMaxDelay});
+    RelayRetryParams retry;
+    retry.ackTimeout = simCfg_.relayAckTimeout;
+    retry.maxAttempts = simCfg_.relayRetryMaxAttempts;
+    retry.maxInFlight = simCfg_.relayMaxInFlight;
+    relayer->setRetry(retry);
+    relayer->setCoordinator(&relayerCoordinator_);
+    relayer->setProofRefresher([this](IBCPacket& pkt) {
+        Blockchain* src = findChain(pkt.srcChain);
+        return src && src->refreshProof(pkt).ok();
+    });
+    for (const auto& [chainId, address] : chainMailboxes_) {
+        relayer->connectChainMailbox(chainId, address);
+    }
+    return relayer;
+}
+
 Status SimulationController::openIBC(const std::string& a, PortId ap, ChannelId ac,
                                      const std::string& b, PortId bp, ChannelId bc) {
     rootLog_.info("Opening IBC channel between " + a + " and " + b);
@@ -77,8 +104,8 @@ Status SimulationController::openIBC(const std::string& a, PortId ap, ChannelId
     if (!chainA || !chainB) {
         return {ErrorCode::NotFound, "One or both chains not found"};
     }
-    chainA->openChannel(ap, ac);
-    chainB->openChannel(bp, bc);
+    chainA->openChannel(ap, ac, simCfg_.channelOrdering);
+    chainB->openChannel(bp, bc, simCfg_.channelOrdering);
     return {ErrorCode::Ok, ""};
 }
 
@@ -93,13 +120,11 @@ Status SimulationController::start() {
     rootLog_.info("All nodes started.");
 
     // Start all relayers
-    rootLog_.info("Starting " + std::to_string(relayers_.size()) + " relayers...");
-    for (auto& relayer : relayers_) {
-        auto relayerStatus = relayer->start();
-        if (!relayerStatus.ok()) {
-            rootLog_.error("Failed to start relayer " + relayer->getRelayerId() + ": " + relayerStatus.message);
-            return relayerStatus;
-        }
+    rootLog_.info("Starting " + std::to_string(simCfg_.relayerCount) + " relayers...");
+    auto relayerStatus = relayerPool_.start(simCfg_.relayerCount);
+    if (!relayerStatus.ok()) {
+        rootLog_.error("Failed to start relayers: " + relayerStatus.message);
+        return relayerStatus;
     }
     rootLog_.info("All relayers started.");
 
@@ -128,9 +153,7 @@ void SimulationController::stop() {
     }
 
     rootLog_.info("Stopping relayers...");
-    for (auto& relayer : relayers_) {
-        relayer->stop();
-    }
+    relayerPool_.stop();
     rootLog_.info("All relayers stopped.");
 
     rootLog_.info("Stopping simulation nodes...");
@@ -158,8 +181,7 @@ void SimulationController::stop() {
 void SimulationController::injectTraffic() {
     rootLog_.info("Injecting traffic...");
 
-    std::random_device rd;
-    std::mt19937 rng(rd());
+    RngStream rng = rng_.stream("inject");
 
     // 1. Collect all node addresses
     std::vector<std::string> all_node_addresses;
@@ -214,10 +236,10 @@ void SimulationController::injectTraffic() {
             Blockchain* src_chain = chains_[src_chain_idx].get();
             Blockchain* dst_chain = chains_[dst_chain_idx].get();
 
-            // Hardcoded port/channel IDs for simplicity, assuming they are opened
-            // These channels need to be opened via controller.openIBC() in main.cpp
+            // Hardcoded port IDs for simplicity. A channel has one counterparty,
+            // so each destination gets its own source channel (opened on first send)
             PortId src_port{"port-A"};
-            ChannelId src_chan{"channel-A"};
+            ChannelId src_chan{"channel-A-" + dst_chain->id()};
             PortId dst_port{"port-B"};
             ChannelId dst_chan{"channel-B"};
 
@@ -345,9 +367,9 @@ void SimulationController::generateRandomIBCPacket()
     Blockchain* src_chain = chains_[src_idx].get();
     Blockchain* dst_chain = chains_[dst_idx].get();
 
-    // Use default port/channel (assumes they're opened in init)
+    // Default ports; one source channel per destination, as a channel has one counterparty
     PortId src_port{"port-A"};
-    ChannelId src_chan{"channel-A"};
+    ChannelId src_chan{"channel-A-" + dst_chain->id()};
     PortId dst_port{"port-B"};
     ChannelId dst_chan{"channel-B"};
 
@@ -367,6 +389,10 @@ void SimulationController::generateRandomIBCPacket()
     {
         metrics_.incCounter("traffic_ibc_tx_generated");
     }
+    else if (pkt_res.status.code == ErrorCode::Backpressure)
+    {
+        metrics_.incCounter("traffic_ibc_tx_throttled"); // offered load above what the channel drains
+    }
     else
     {
         rootLog_.warn("Failed to generate IBC packet: " + pkt_res.status.message);
@@ -6,11 +6,13 @@
 #include <thread>
 #include <atomic>
 #include <random>
+#include "util/Rng.h"
 #include "config/ChainConfig.h"
 #include "config/SimulationConfig.h"
 #include "core/Blockchain.h"
 #include "core/Node.h"
 #include "ibc/Relayer.h"
+#include "ibc/RelayerPool.h"
 #include "net/Transport.h"
 #include "core/EventBus.h"
 #include "util/Logger.h"
@@ -38,16 +40,21 @@ private:
     Logger rootLog_;
     MetricsSink metrics_;
     DetailedLogger detailedLogger_;
+    RngService rng_; // every random stream in the run derives from rngSeed
     NetworkParams netParams_;
     Transport transport_;
     std::vector<std::unique_ptr<Blockchain>> chains_;
     std::vector<std::unique_ptr<Node>> nodes_;
-    std::vector<std::unique_ptr<Relayer>> relayers_;  // Multiple relayers
+    RelayerCoordinator relayerCoordinator_;           // shared by the pool's relayers, outlives them
+    std::vector<std::pair<std::string, std::string>> chainMailboxes_; // chainId -> mailbox address
+    RelayerPool relayerPool_;                         // Multiple relayers
+
+    std::unique_ptr<Relayer> makeRelayer(size_t index); // RelayerPool factory
 
     // Traffic generator infrastructure
     std::thread trafficThread_;
     std::atomic<bool> trafficRunning_{false};
-    std::mt19937 trafficRng_;
+    RngStream trafficRng_;
 
     // Helper methods
     Blockchain *findChain(const std::string &id);
@@ -229,11 +229,23 @@ void DetailedLogger::logIBCEvent(
     case IBCEventType::AckReceived:
         event_name = "ack_received";
         break;
+    case IBCEventType::PacketTimedOut:
+        event_name = "packet_timed_out";
+        break;
     default:
         event_name = "unknown";
         break;
     }
 
+    // Names the data packet, so a packet's events join with its ack's: an
+    // ack's destination is the packet's source
+    const bool isAck = event_type == IBCEventType::AckGenerated ||
+                       event_type == IBCEventType::AckRelayed ||
+                       event_type == IBCEventType::AckReceived;
+    std::string tx_id = isAck ? dst_chain + "/" + dst_port + "/" + dst_channel
+                              : src_chain + "/" + src_port + "/" + src_channel;
+    tx_id += "/" + std::to_string(sequence);
+
     std::ostringstream ss;
     ss << "{";
     ss << "\"ts\":\"" << escapeJson(nowIso8601()) << "\",";
@@ -245,6 +257,7 @@ void DetailedLogger::logIBCEvent(
     ss << "\"dst_port\":\"" << escapeJson(dst_port) << "\",";
     ss << "\"dst_channel\":\"" << escapeJson(dst_channel) << "\",";
     ss << "\"sequence\":" << sequence << ",";
+    ss << "\"tx_id\":\"" << escapeJson(tx_id) << "\",";
     ss << "\"payload\":\"" << escapeJson(payload) << "\"";
 
     if (!relayer_id.empty())
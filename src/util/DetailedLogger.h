@@ -39,7 +39,8 @@ enum class IBCEventType
     PacketReceived,
     AckGenerated,
     AckRelayed,
-    AckReceived
+    AckReceived,
+    PacketTimedOut
 };
 
 // A single logger output stream
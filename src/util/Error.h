@@ -15,6 +15,7 @@ enum class ErrorCode
     ChannelClosed,
     NotFound,
     Cancelled,
+    Backpressure, // try again later, e.g. a send window is full
     Unknown
 };
 
@@ -0,0 +1,39 @@
+#include "Histogram.h"
+#include <algorithm>
+#include <cmath>
+
+void Histogram::record(double value)
+{
+    buckets_[bucketOf(value)]++;
+    count_++;
+    sum_ += value;
+    max_ = std::max(max_, value);
+}
+
+// Reports the geometric middle of the bucket holding the q-th value
+double Histogram::quantile(double q) const
+{
+    if (count_ == 0)
+        return 0.0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count_)));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kBuckets; ++b)
+    {
+        seen += buckets_[b];
+        if (seen >= rank)
+        {
+            double mid = b == 0 ? kMin / 2 : kMin * std::exp2((static_cast<double>(b) - 0.5) / kBucketsPerDoubling);
+            return std::min(mid, max_);
+        }
+    }
+    return max_;
+}
+
+size_t Histogram::bucketOf(double value)
+{
+    if (!(value > kMin))
+        return 0;
+    double b = std::floor(std::log2(value / kMin) * kBucketsPerDoubling) + 1.0;
+    return static_cast<size_t>(std::min(b, static_cast<double>(kBuckets - 1)));
+}
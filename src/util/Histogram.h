@@ -0,0 +1,29 @@
+// util/Histogram.h
+// Log-bucketed histogram for latencies, within about 5% of the true quantiles.
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+class Histogram
+{
+public:
+    void record(double value); // values below kMin land in the first bucket
+
+    uint64_t count() const { return count_; }
+    double mean() const { return count_ ? sum_ / static_cast<double>(count_) : 0.0; }
+    double max() const { return max_; }
+    double quantile(double q) const; // q in [0, 1]; 0 when empty
+
+private:
+    static constexpr double kMin = 0.01;           // first bucket's upper edge
+    static constexpr int kBucketsPerDoubling = 8;  // 2^(1/8): about 9% wide buckets
+    static constexpr size_t kBuckets = kBucketsPerDoubling * 40 + 1; // up to kMin * 2^40
+
+    static size_t bucketOf(double value);
+
+    std::array<uint64_t, kBuckets> buckets_{};
+    uint64_t count_{0};
+    double sum_{0.0};
+    double max_{0.0};
+};
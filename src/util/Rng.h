@@ -0,0 +1,86 @@
+// util/Rng.h
+// Counter-based random streams derived from one simulation seed.
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+// SplitMix64 finalizer: a bijective 64-bit mixer.
+inline uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// FNV-1a, so stream keys do not depend on the standard library's std::hash.
+inline uint64_t stableHash(std::string_view s)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (char c : s)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+// One independent stream. Draw i is a pure function of (key, i), so an
+// owner can either step through it with next()/operator() or ask for the
+// draw belonging to a specific event with at(), which gives the same value
+// no matter which thread asks or when.
+class RngStream
+{
+public:
+    using result_type = uint64_t;
+
+    RngStream() = default;
+    explicit RngStream(uint64_t key) : key_(key) {}
+
+    uint64_t at(uint64_t counter) const
+    {
+        return splitmix64(key_ ^ splitmix64(counter));
+    }
+
+    // Uniform double in [0, 1) for event `counter`
+    double uniformAt(uint64_t counter) const
+    {
+        return static_cast<double>(at(counter) >> 11) * 0x1.0p-53;
+    }
+
+    // Sequential draws (single owner); satisfies UniformRandomBitGenerator
+    uint64_t next() { return at(counter_++); }
+    double uniform() { return uniformAt(counter_++); }
+    result_type operator()() { return next(); }
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    // Sub-stream for a nested component
+    RngStream derive(std::string_view domain, uint64_t id = 0) const
+    {
+        return RngStream(splitmix64(key_ ^ splitmix64(stableHash(domain) ^ splitmix64(id))));
+    }
+
+    uint64_t key() const { return key_; }
+
+private:
+    uint64_t key_{0};
+    uint64_t counter_{0};
+};
+
+// Root of all streams for a run: components ask for a stream by domain name
+// and id (e.g. "relayer", 2) instead of sharing a generator.
+class RngService
+{
+public:
+    explicit RngService(uint64_t seed) : root_(splitmix64(seed)) {}
+
+    RngStream stream(std::string_view domain, uint64_t id = 0) const
+    {
+        return root_.derive(domain, id);
+    }
+
+private:
+    RngStream root_;
+};
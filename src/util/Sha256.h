@@ -0,0 +1,10 @@
+// util/Sha256.h
+// SHA-256 for commitments and proofs, with no external dependency.
+#pragma once
+#include <string>
+#include <string_view>
+
+// Raw 32-byte digest
+std::string sha256(std::string_view data);
+std::string toHex(std::string_view bytes);
+bool fromHex(std::string_view hex, std::string &out); // false on odd length or a non-hex digit
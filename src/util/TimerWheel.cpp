@@ -0,0 +1,61 @@
+#include "TimerWheel.h"
+#include <algorithm>
+
+TimerWheel::TimerWheel(uint64_t tickMs, size_t slots)
+    : tickMs_(std::max<uint64_t>(1, tickMs)), slots_(std::max<size_t>(1, slots))
+{
+}
+
+void TimerWheel::schedule(uint64_t id, uint64_t deadlineMs)
+{
+    // Already passed: fires on the next advance()
+    uint64_t tick = std::max(deadlineMs / tickMs_, currentTick_);
+    deadlines_[id] = tick;
+    slots_[tick % slots_.size()].push_back(id);
+}
+
+bool TimerWheel::cancel(uint64_t id)
+{
+    return deadlines_.erase(id) > 0; // its slot entry goes stale
+}
+
+std::vector<uint64_t> TimerWheel::advance(uint64_t nowMs)
+{
+    std::vector<uint64_t> expired;
+    uint64_t nowTick = nowMs / tickMs_;
+    if (nowTick < currentTick_)
+        return expired;
+
+    // The current tick is visited again, for timers scheduled into it since.
+    // A jump of a full turn or more visits every slot once.
+    uint64_t from = nowTick - currentTick_ >= slots_.size() ? nowTick + 1 - slots_.size() : currentTick_;
+    for (uint64_t t = from; t <= nowTick; ++t)
+    {
+        expireSlot(t % slots_.size(), nowTick, expired);
+    }
+    currentTick_ = nowTick;
+    return expired;
+}
+
+// Slots also hold ids of later turns; those stay
+void TimerWheel::expireSlot(size_t slot, uint64_t nowTick, std::vector<uint64_t> &out)
+{
+    std::vector<uint64_t> &ids = slots_[slot];
+    size_t kept = 0;
+    for (uint64_t id : ids)
+    {
+        auto it = deadlines_.find(id);
+        if (it == deadlines_.end() || it->second % slots_.size() != slot)
+            continue; // cancelled or moved to another slot
+        if (it->second <= nowTick)
+        {
+            deadlines_.erase(it);
+            out.push_back(id);
+        }
+        else
+        {
+            ids[kept++] = id;
+        }
+    }
+    ids.resize(kept);
+}
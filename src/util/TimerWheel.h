@@ -0,0 +1,30 @@
+// util/TimerWheel.h
+// Hashed timing wheel for many deadlines that are mostly cancelled.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Deadlines are in caller-chosen milliseconds and rounded down to a tick.
+// schedule() and cancel() are O(1); advance() only visits the slots of the
+// ticks that passed. Not thread-safe.
+class TimerWheel
+{
+public:
+    explicit TimerWheel(uint64_t tickMs = 10, size_t slots = 512);
+
+    void schedule(uint64_t id, uint64_t deadlineMs); // moves an id that is already scheduled
+    bool cancel(uint64_t id);
+    // Removes and returns the ids whose deadline is at or before nowMs
+    std::vector<uint64_t> advance(uint64_t nowMs);
+    size_t size() const { return deadlines_.size(); }
+
+private:
+    void expireSlot(size_t slot, uint64_t nowTick, std::vector<uint64_t> &out);
+
+    uint64_t tickMs_;
+    std::vector<std::vector<uint64_t>> slots_; // may hold stale ids, dropped when visited
+    std::unordered_map<uint64_t, uint64_t> deadlines_; // id -> deadline tick
+    uint64_t currentTick_{0}; // last tick advance() visited
+};
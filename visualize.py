@@ -11,6 +11,11 @@ def load_jsonl(file_path):
             data.append(json.loads(line))
     return pd.DataFrame(data)
 
+def first_event(ibc_events_df, event):
+    # One row per packet: a retried relay or a duplicate ack logs an event again
+    rows = ibc_events_df[ibc_events_df['event'] == event]
+    return rows.drop_duplicates('tx_id').set_index('tx_id')
+
 def plot_aggregate_metrics(metrics_df):
     plt.figure(figsize=(12, 8))
     metrics_df['name'].value_counts().plot(kind='bar')
@@ -27,8 +32,8 @@ def plot_latency_distribution(ibc_events_df, transactions_df):
     transactions_df['ts'] = pd.to_datetime(transactions_df['ts'])
 
     # IBC Packet Latency
-    packet_created = ibc_events_df[ibc_events_df['event'] == 'packet_created'].set_index('tx_id')
-    ack_received = ibc_events_df[ibc_events_df['event'] == 'ack_received'].set_index('tx_id')
+    packet_created = first_event(ibc_events_df, 'packet_created')
+    ack_received = first_event(ibc_events_df, 'ack_received')
     ibc_latency = (ack_received['ts'] - packet_created['ts']).dt.total_seconds().dropna()
 
     plt.figure(figsize=(12, 6))
@@ -73,8 +78,8 @@ def plot_throughput_and_latency(metrics_df, ibc_events_df):
 
     # Latency over time
     ibc_events_df['ts'] = pd.to_datetime(ibc_events_df['ts'])
-    packet_created = ibc_events_df[ibc_events_df['event'] == 'packet_created'].set_index('tx_id')
-    ack_received = ibc_events_df[ibc_events_df['event'] == 'ack_received'].set_index('tx_id')
+    packet_created = first_event(ibc_events_df, 'packet_created')
+    ack_received = first_event(ibc_events_df, 'ack_received')
     ibc_latency_df = pd.DataFrame({
         'created_ts': packet_created['ts'],
         'latency': (ack_received['ts'] - packet_created['ts']).dt.total_seconds()